@@ -25,6 +25,9 @@
 
 namespace Stockfish::Benchmark {
 
+// The positions searched by the bench command
+const std::vector<std::string>& default_positions();
+
 std::vector<std::string> setup_bench(const std::string&, std::istream&);
 
 struct BenchmarkSetup {
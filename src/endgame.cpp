@@ -0,0 +1,92 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "endgame.h"
+
+#include <cassert>
+#include <string_view>
+#include <unordered_map>
+
+#include "position.h"
+
+namespace Stockfish::Endgames {
+
+namespace {
+
+constexpr std::string_view PieceToChar(" RACPNBK");
+
+// Filled by init() and only read afterwards
+std::unordered_map<Key, Endgame> registry;
+
+// Advisors and bishops cannot cross the river and a cannon needs a screen, so
+// with these pieces alone no check can ever be given.
+Value dead_draw(const Position&, Color) { return VALUE_DRAW; }
+
+// Registers the endgame with each colour as the strong side
+void add(const std::string& code, Value (*evaluate)(const Position&, Color)) {
+
+    for (Color c : {WHITE, BLACK})
+        registry[material_key(code, c)] = {c, evaluate};
+}
+
+}  // namespace
+
+
+Key material_key(const std::string& code, Color strongSide) {
+
+    Key   key = 0;
+    Color c   = strongSide;
+
+    for (char token : code)
+    {
+        if (token == 'v')
+        {
+            c = ~c;
+            continue;
+        }
+
+        size_t pt = PieceToChar.find(token);
+        assert(pt != std::string_view::npos && pt != 0);
+
+        key += Key(1) << (4 * make_piece(c, PieceType(pt)));
+    }
+
+    return key;
+}
+
+
+void init() {
+
+    // Every combination of advisors and bishops of a side
+    const std::string Defenders[] = {"", "A", "AA", "B", "AB", "AAB", "BB", "ABB", "AABB"};
+
+    for (const std::string& strong : Defenders)
+        for (const std::string& weak : Defenders)
+            add("K" + strong + "vK" + weak, dead_draw);
+
+    add("KCvK", dead_draw);
+}
+
+
+const Endgame* probe(Key materialKey) {
+
+    auto it = registry.find(materialKey);
+    return it != registry.end() ? &it->second : nullptr;
+}
+
+}  // namespace Stockfish::Endgames
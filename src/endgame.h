@@ -0,0 +1,54 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENDGAME_H_INCLUDED
+#define ENDGAME_H_INCLUDED
+
+#include <string>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+namespace Endgames {
+
+// A specialised evaluation for a material configuration, keyed by the material
+// key of Position. 'evaluate' gives the exact value of the position from the
+// point of view of the side to move, bypassing NNUE. The strong side is the one
+// whose pieces come first in the code of the configuration, e.g. "KC" in "KCvK".
+struct Endgame {
+    Color strongSide;
+    Value (*evaluate)(const Position& pos, Color strongSide);
+};
+
+void init();
+
+// Returns the endgame registered for the material key, if any
+const Endgame* probe(Key materialKey);
+
+// The material key of a configuration given as "KRvKAABB", the pieces before
+// the 'v' belonging to 'strongSide'.
+Key material_key(const std::string& code, Color strongSide);
+
+}  // namespace Endgames
+
+}  // namespace Stockfish
+
+#endif  // #ifndef ENDGAME_H_INCLUDED
@@ -18,17 +18,28 @@
 
 #include "engine.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <numeric>
 #include <sstream>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "benchmark.h"
 #include "evaluate.h"
+#include "gamerecord.h"
+#include "memory.h"
 #include "misc.h"
+#include "movegen.h"
 #include "nnue/network.h"
+#include "nnue/nnue_architecture.h"
 #include "perft.h"
 #include "position.h"
 #include "search.h"
@@ -43,12 +54,90 @@ namespace NN = Eval::NNUE;
 constexpr auto StartFEN  = "rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C5C1/9/RNBAKABNR w"; // 初始局面
 constexpr int  MaxHashMB = Is64Bit ? 33554432 : 2048; // 哈希表（置换表）最大占用
 
+// Kept out of the memory budget for the code, the game history, the buffers of
+// the standard library and the allocator overhead.
+constexpr size_t MemoryReserveMB = 64;
+
+namespace {
+
+// Adds the features active for both sides in the position to the counts
+void count_features(const Position& pos, std::vector<std::uint64_t>& counts) {
+
+    NN::FeatureSet::IndexList white, black;
+    NN::FeatureSet::append_active_file_indices<WHITE>(pos, white);
+    NN::FeatureSet::append_active_file_indices<BLACK>(pos, black);
+
+    for (auto index : white)
+        ++counts[index];
+    for (auto index : black)
+        ++counts[index];
+}
+
+// Counts the features of every position of the games in the file, or of the
+// bench positions and their children if no file is given. Returns the number
+// of positions, zero if the file cannot be read.
+size_t count_features(const std::string& path, std::vector<std::uint64_t>& counts) {
+
+    size_t    positions = 0;
+    StateInfo st[2];
+    Position  pos;
+
+    if (path.empty())
+    {
+        for (const auto& fen : Benchmark::default_positions())
+        {
+            pos.set(fen, &st[0]);
+            count_features(pos, counts);
+            ++positions;
+
+            for (const auto& m : MoveList<LEGAL>(pos))
+            {
+                pos.do_move(m, st[1]);
+                count_features(pos, counts);
+                pos.undo_move(m);
+                ++positions;
+            }
+        }
+        return positions;
+    }
+
+    GameRecord::MappedFile file(path);
+    if (!file.is_open())
+        return 0;
+
+    std::deque<StateInfo> states(1);
+
+    for (auto text : GameRecord::split_games(file.view()))
+    {
+        GameRecord::Game game = GameRecord::parse_game(text);
+
+        states.resize(1);
+        pos.set(game.fen, &states.back());
+        count_features(pos, counts);
+        ++positions;
+
+        for (Move m : game.moves)
+        {
+            pos.do_move(m, states.emplace_back());
+            count_features(pos, counts);
+            ++positions;
+        }
+    }
+
+    return positions;
+}
+
+}  // namespace
+
 Engine::Engine(std::optional<std::string> path) :
     binaryDirectory(path ? CommandLine::get_binary_directory(*path) : ""),
     numaContext(NumaConfig::from_system()),
     states(new std::deque<StateInfo>(1)),
+    positionFen(StartFEN),
     threads(),
-    network(numaContext, NN::Network({EvalFileDefaultName, "None", ""})) {
+    network(numaContext,
+            NN::Network({EvalFileDefaultName, "None", ""}),
+            NN::Network({EvalFileDefaultName, "None", ""})) {
     pos.set(StartFEN, &states->back()); // 将当前局面设置为初始局面
 
     // 定义UCI选项
@@ -57,6 +146,16 @@ Engine::Engine(std::optional<std::string> path) :
         return std::nullopt;
     });
 
+    options["Debug Log Timestamps"] << Option(false, [this](const Option& o) {
+        configure_logger(o, size_t(options["Debug Log Max Size"]) * 1024 * 1024);
+        return std::nullopt;
+    });
+
+    options["Debug Log Max Size"] << Option(0, 0, 65536, [this](const Option& o) {
+        configure_logger(options["Debug Log Timestamps"], size_t(int(o)) * 1024 * 1024);
+        return std::nullopt;
+    });
+
     options["NumaPolicy"] << Option("auto", [this](const Option& o) {
         set_numa_config_from_option(o);
         return numa_config_information_as_string() + "\n"
@@ -65,12 +164,43 @@ Engine::Engine(std::optional<std::string> path) :
 
     options["Threads"] << Option(1, 1, 1024, [this](const Option&) {
         resize_threads();
-        return thread_allocation_information_as_string();
+        return thread_allocation_information_as_string()
+             + (memory_budget() ? "\n" + memory_information_as_string() : "");
     });
 
+    // The best-first tree counts in the memory budget once that search is chosen,
+    // and is freed when another one is.
+    auto onBestFirstChange = [this](const Option&) {
+        if (std::string(options["Parallel Search"]) != "BestFirst")
+        {
+            wait_for_search_finished();
+            threads.bestFirstTree.release();
+        }
+
+        if (memory_budget())
+            set_tt_size(options["Hash"]);
+        return std::nullopt;
+    };
+
+    options["Parallel Search"] << Option("LazySMP var LazySMP var YBWC var BestFirst", "LazySMP",
+                                         onBestFirstChange);
+    options["BestFirst Memory"] << Option(256, 1, MaxHashMB, onBestFirstChange);
+
     options["Hash"] << Option(16, 1, MaxHashMB, [this](const Option& o) {
         set_tt_size(o);
-        return std::nullopt;
+        return memory_budget() ? std::optional<std::string>(memory_information_as_string())
+                               : std::nullopt;
+    });
+
+    options["MemoryBudget"] << Option("auto", [this](const Option&) {
+        set_tt_size(options["Hash"]);
+        return memory_information_as_string();
+    });
+
+    options["Shared Hash"] << Option("", [this](const Option&) {
+        set_tt_size(options["Hash"]);
+        return tt.sharing_status().empty() ? std::nullopt
+                                           : std::optional<std::string>(tt.sharing_status());
     });
 
     options["Clear Hash"] << Option([this](const Option&) {
@@ -82,11 +212,17 @@ Engine::Engine(std::optional<std::string> path) :
     options["Move Overhead"] << Option(10, 0, 5000);
     options["nodestime"] << Option(0, 0, 10000);
     options["UCI_ShowWDL"] << Option(false);
-    options["EvalFile"] << Option(EvalFileDefaultName, [this](const Option& o) {
-        load_network(o);
-        return std::nullopt;
+    options["JSON Output"] << Option(false);
+    options["History File"] << Option("", [this](const Option& o) {
+        return std::string(o).empty() ? std::nullopt
+                                      : std::optional<std::string>(load_history(o));
     });
+    options["Feature Profile"] << Option(
+      "", [this](const Option& o) { return set_feature_profile(o); });
+    options["EvalFile"] << Option(EvalFileDefaultName,
+                                  [this](const Option& o) { return load_network(o); });
 
+    set_feature_profile(options["Feature Profile"]);
     load_network(options["EvalFile"]);
     resize_threads();
 }
@@ -97,19 +233,140 @@ std::uint64_t Engine::perft(const std::string& fen, Depth depth) {
     return Benchmark::perft(fen, depth);
 }
 
+std::vector<std::uint64_t>
+Engine::perft_batch(const std::vector<std::pair<std::string, Depth>>& jobs) {
+    verify_network();
+    wait_for_search_finished();
+
+    // Deepest jobs first, so that no thread is left with a big one at the end
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return jobs[a].second > jobs[b].second; });
+
+    std::vector<std::uint64_t> nodes(jobs.size());
+    std::atomic<size_t>        next(0);
+
+    for (size_t i = 0; i < threads.num_threads(); ++i)
+        threads.run_on_thread(i, [&]() {
+            for (size_t j; (j = next++) < order.size();)
+            {
+                const auto& [fen, depth] = jobs[order[j]];
+                nodes[order[j]]          = Benchmark::perft_count(fen, depth);
+            }
+        });
+
+    for (size_t i = 0; i < threads.num_threads(); ++i)
+        threads.wait_on_thread(i);
+
+    return nodes;
+}
+
+std::vector<Search::BatchResult>
+Engine::search_batch(const std::vector<ThreadPool::BatchJob>& jobs,
+                     const Search::LimitsType&                limits,
+                     size_t                                   concurrency,
+                     const ThreadPool::BatchIteration&        onIteration) {
+    finish_network_swap();
+    verify_network();
+    wait_for_search_finished();
+
+    tt.new_search();
+
+    return threads.search_batch(jobs, limits, concurrency, onIteration);
+}
+
+GameRecord::ImportStats Engine::import_games(const std::string& input,
+                                             const std::string& output,
+                                             GameRecord::Format format) {
+    wait_for_search_finished();
+
+    return GameRecord::import(threads, input, output, format);
+}
+
 void Engine::go(Search::LimitsType& limits) {
     assert(limits.perft == 0);
+    finish_network_swap();
     verify_network();
 
     threads.start_thinking(pos, states, limits);
 }
 void Engine::stop() { threads.stop = true; }
 
+bool Engine::suspend() { return threads.suspend(); }
+
+bool Engine::resume() {
+    finish_network_swap();
+    verify_network();
+
+    return threads.resume(states);
+}
+
+bool Engine::can_suspend() const { return threads.can_suspend(); }
+
+bool Engine::go_priority(Search::LimitsType& limits) {
+    assert(!limits.infinite && !limits.ponderMode);
+
+    if (!threads.can_suspend() && threads.searching())
+        return false;
+
+    const bool preempted = suspend();
+
+    go(limits);
+    wait_for_search_finished();
+
+    if (preempted)
+        resume();
+
+    return true;
+}
+
 void Engine::search_clear() {
     wait_for_search_finished();
 
     tt.clear(threads);
     threads.clear();
+    warm_start_histories();
+}
+
+// Writes the histories of the main thread, to be loaded by later processes
+std::string Engine::save_history(const std::string& file) {
+
+    std::ofstream stream(file, std::ios::binary);
+    if (!stream)
+        return "Failed to open " + file;
+
+    threads.save_histories(stream);
+
+    if (!stream)
+        return "Failed to write the histories to " + file;
+
+    return "Histories saved to " + file + " (" + std::to_string(stream.tellp() / 1024) + " KiB)";
+}
+
+std::string Engine::load_history(const std::string& file) {
+
+    wait_for_search_finished();
+
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream)
+        return "Failed to open " + file;
+
+    const std::string data((std::istreambuf_iterator<char>(stream)),
+                           std::istreambuf_iterator<char>());
+
+    return threads.load_histories(data)
+           ? "Histories loaded from " + file + " into " + std::to_string(threads.size())
+               + " threads"
+           : file + " is not a valid history file, the histories are cleared";
+}
+
+// The histories of new games, and of new threads, start from the History File
+// if one is set instead of being empty.
+void Engine::warm_start_histories() {
+
+    if (!std::string(options["History File"]).empty())
+        load_history(options["History File"]);
 }
 
 void Engine::set_on_update_no_moves(std::function<void(const Engine::InfoShort&)>&& f) {
@@ -135,6 +392,9 @@ void Engine::set_on_verify_networks(std::function<void(std::string_view)>&& f) {
 void Engine::wait_for_search_finished() { threads.main_thread()->wait_for_search_finished(); }
 
 void Engine::set_position(const std::string& fen, const std::vector<std::string>& moves) {
+    positionFen   = fen;
+    positionMoves = moves;
+
     // Drop the old state and create a new one
     states = StateListPtr(new std::deque<StateInfo>(1));
     pos.set(fen, &states->back());
@@ -148,9 +408,17 @@ void Engine::set_position(const std::string& fen, const std::vector<std::string>
 
         states->emplace_back();
         pos.do_move(m, states->back());
+
+        // These states are shared by the search threads, so they must not be
+        // written to lazily during the search, see Position::set_check_info().
+        pos.set_check_info();
     }
 }
 
+std::pair<std::string, std::vector<std::string>> Engine::position_setup() const {
+    return {positionFen, positionMoves};
+}
+
 // modifiers
 
 void Engine::set_numa_config_from_option(const std::string& o) {
@@ -184,28 +452,244 @@ void Engine::resize_threads() {
     // Reallocate the hash with the new threadpool size
     set_tt_size(options["Hash"]);
     threads.ensure_network_replicated();
+    warm_start_histories();
 }
 
+// The entries of the old table are migrated to the new one, unless the two of
+// them would not fit together in the memory budget: the old table is then freed
+// before the new one is allocated.
 void Engine::set_tt_size(size_t mb) {
     wait_for_search_finished();
-    tt.resize(mb, threads);
+
+    const auto   budget = memory_budget();
+    const size_t hash   = hash_within_budget(mb);
+    const size_t oldMB  = (tt.private_size() + (1 << 20) - 1) >> 20;
+    const size_t others = (memory_usage().total() + (1 << 20) - 1) >> 20;
+
+    tt.resize(hash, threads, std::string(options["Shared Hash"]),
+              !budget || oldMB + hash + others <= *budget);
+}
+
+// Everything but the transposition table is sized by other options, so the
+// hash gets what the budget leaves, at most the Hash option and at least 1 MB.
+size_t Engine::hash_within_budget(size_t mb) const {
+
+    const auto budget = memory_budget();
+    if (!budget)
+        return mb;
+
+    const size_t others = (memory_usage().total() + (1 << 20) - 1) >> 20;
+
+    return std::clamp(*budget > others ? *budget - others : 1, size_t(1), mb);
+}
+
+// The MemoryBudget option in MB, "auto" standing for the memory limit of the
+// cgroup of the process, if it has one, and "none" for no budget.
+std::optional<size_t> Engine::memory_budget() const {
+
+    const std::string budget = options["MemoryBudget"];
+
+    if (budget == "auto")
+    {
+        const auto limit = cgroup_memory_limit();
+        return limit ? std::optional<size_t>(*limit >> 20) : std::nullopt;
+    }
+
+    size_t             mb;
+    std::istringstream ss(budget);
+    return ss >> mb && mb ? std::optional<size_t>(mb) : std::nullopt;
+}
+
+Engine::MemoryUsage Engine::memory_usage() const {
+
+    MemoryUsage usage{};
+
+    // Each thread has its worker, with the histories and the accumulator
+    // caches, a copy of them per suspended search, and on its native stack the
+    // search stack and a StateInfo, accumulators included, per ply.
+    usage.perThread = sizeof(Thread) + sizeof(Search::Worker)
+                    + threads.suspended_searches() * sizeof(Search::WorkerSnapshot)
+                    + (MAX_PLY + 10) * sizeof(Search::Stack) + MAX_PLY * sizeof(StateInfo);
+    usage.threads = threads.size();
+
+    // The network is replicated on every NUMA node with bound threads
+    const auto boundThreads = threads.get_bound_thread_count_by_numa_node();
+    usage.perReplica        = NN::Network::MemorySize;
+    usage.replicas          = std::max<size_t>(
+      1, std::count_if(boundThreads.begin(), boundThreads.end(), [](size_t n) { return n; }));
+
+    usage.bestFirstTree = std::string(options["Parallel Search"]) == "BestFirst"
+                          ? size_t(options["BestFirst Memory"]) << 20
+                          : 0;
+    usage.reserve       = MemoryReserveMB << 20;
+
+    return usage;
+}
+
+std::string Engine::memory_information_as_string() const {
+
+    const auto   budget    = memory_budget();
+    const auto   usage     = memory_usage();
+    const size_t requested = options["Hash"];
+    const size_t hash      = hash_within_budget(requested);
+    const size_t total     = hash + ((usage.total() + (1 << 20) - 1) >> 20);
+
+    auto mb = [](size_t bytes) { return std::to_string((bytes + (1 << 20) - 1) >> 20) + " MB"; };
+
+    std::stringstream ss;
+
+    if (budget)
+        ss << "Memory budget " << *budget << " MB"
+           << (std::string(options["MemoryBudget"]) == "auto" ? " (cgroup limit)" : "") << ": ";
+    else
+        ss << "No memory budget: ";
+
+    ss << "Hash " << hash << " MB";
+    if (hash < requested)
+        ss << " (" << requested << " MB requested)";
+
+    ss << ", " << usage.threads << " x " << mb(usage.perThread) << " for the threads, "
+       << usage.replicas << " x " << mb(usage.perReplica) << " for the network";
+
+    if (usage.bestFirstTree)
+        ss << ", " << mb(usage.bestFirstTree) << " for the best-first tree";
+
+    ss << ", " << mb(usage.reserve) << " reserved, " << total << " MB in total";
+
+    if (budget && total > *budget)
+    {
+        ss << ". This is " << total - *budget << " MB over the budget, use fewer Threads";
+        if (usage.bestFirstTree)
+            ss << ", a smaller BestFirst Memory";
+        if (usage.replicas > 1)
+            ss << " or NumaPolicy none to keep a single copy of the network";
+    }
+
+    return ss.str();
 }
 
 void Engine::set_ponderhit(bool b) { threads.main_manager()->ponder = b; }
 
 // network related
 
-void Engine::verify_network() const { network->verify(options["EvalFile"], onVerifyNetworks); }
+void Engine::verify_network() const {
+    network.current()->verify(options["EvalFile"], onVerifyNetworks);
+}
+
+// The network is loaded into the standby buffer. When idle it is published at
+// once and the histories are cleared as before. During a search the network is
+// also replicated to every NUMA node before being published, and each thread
+// switches to it at its next iteration, so the search never waits for the load.
+std::optional<std::string> Engine::load_network(const std::string& file) {
+
+    if (network.current()->loaded(file))
+        return std::nullopt;
+
+    const bool      searching = threads.searching();
+    const TimePoint start     = now();
+
+    // The standby buffer may still be used by threads that did not switch to
+    // the network published last yet. Waiting for them here would block the
+    // UCI thread, and with it the "stop" command, for up to a whole iteration.
+    if (searching && !threads.network_sync_time(network.generation()))
+        return "The previous network is not used by every search thread yet, " + file
+             + " will be loaded before the next search";
 
-void Engine::load_network(const std::string& file) {
-    network.modify_and_replicate(
+    network.standby().modify_and_replicate(
       [this, &file](NN::Network& network_) { network_.load(binaryDirectory, file); });
-    threads.clear();
-    threads.ensure_network_replicated();
+
+    if (!searching)
+    {
+        network.publish();
+        network.standby() = NN::Network({EvalFileDefaultName, "None", ""});
+        threads.clear();
+        threads.ensure_network_replicated();
+        return std::nullopt;
+    }
+
+    if (!network.standby()->loaded(file))
+        return "Failed to load the network " + file + ", the search goes on with the current one";
+
+    network.standby().replicate_all();
+
+    networkPublished = now();
+    networkLoadTime  = networkPublished - start;
+    network.publish();
+
+    return "Network " + file + " loaded in " + std::to_string(networkLoadTime)
+         + " ms, the search threads switch to it at their next iteration";
+}
+
+// Reports how long the threads took to pick up a network loaded during the
+// last search and frees the network it replaced. A network that could not be
+// swapped in during the search is loaded now.
+void Engine::finish_network_swap() {
+
+    if (networkPublished)
+    {
+        auto syncTime = threads.network_sync_time(network.generation());
+
+        if (onVerifyNetworks)
+            onVerifyNetworks(
+              "Network swap: loaded and replicated in " + std::to_string(networkLoadTime)
+              + " ms, "
+              + (syncTime ? "used by every thread " + std::to_string(*syncTime - networkPublished)
+                              + " ms after that"
+                          : std::string("some threads switch at the start of this search")));
+
+        network.standby() = NN::Network({EvalFileDefaultName, "None", ""});
+        networkPublished  = 0;
+    }
+
+    load_network(options["EvalFile"]);
+}
+
+// The rows of the feature transformer are laid out by decreasing frequency of
+// their features in the profile, so that the rows read by most accumulator
+// updates share as few pages and cache sets as possible. The evaluation does
+// not depend on the order, and the networks are still saved in file order.
+std::optional<std::string> Engine::set_feature_profile(const std::string& path) {
+
+    // Called by the constructor before any network is loaded, there is then
+    // nothing to reorder.
+    const bool loaded = !threads.empty();
+
+    if (loaded)
+    {
+        wait_for_search_finished();
+        finish_network_swap();
+    }
+
+    std::vector<std::uint64_t> counts(NN::FeatureSet::Dimensions);
+
+    const size_t positions = count_features(path, counts);
+    if (!positions)
+        return "Failed to read the feature profile " + path + ", the row order is unchanged";
+
+    const auto rows = NN::FeatureSet::order_by_frequency(counts);
+    const std::vector<NN::FeatureSet::RowIndex> old(NN::FeatureSet::RowOf.begin(),
+                                                    NN::FeatureSet::RowOf.end());
+
+    std::copy(rows.begin(), rows.end(), NN::FeatureSet::RowOf.begin());
+
+    if (loaded)
+        network.current().modify_and_replicate(
+          [&](NN::Network& network_) { network_.reorder_features(old.data(), rows.data()); });
+
+    // Share of the activations falling into the most used tenth of the rows
+    std::sort(counts.begin(), counts.end(), std::greater<>());
+    const auto total = std::accumulate(counts.begin(), counts.end(), std::uint64_t(0));
+    const auto top   = std::accumulate(counts.begin(), counts.begin() + counts.size() / 10,
+                                       std::uint64_t(0));
+
+    return "Feature rows ordered on " + std::to_string(positions) + " positions, "
+         + std::to_string(total ? top * 100 / total : 0)
+         + "% of the activations hit the first 10% of the rows";
 }
 
 void Engine::save_network(const std::optional<std::string>& file) {
-    network.modify_and_replicate([&file](NN::Network& network_) { network_.save(file); });
+    network.current().modify_and_replicate(
+      [&file](NN::Network& network_) { network_.save(file); });
 }
 
 // utility functions
@@ -217,7 +701,23 @@ void Engine::trace_eval() const {
 
     verify_network();
 
-    sync_cout << "\n" << Eval::trace(p, *network) << sync_endl;
+    sync_cout << "\n" << Eval::trace(p, *network.current()) << sync_endl;
+}
+
+std::optional<Engine::PieceValues> Engine::piece_values() const {
+    if (pos.checkers())
+        return std::nullopt;
+
+    verify_network();
+
+    const Eval::NNUE::PieceValues pv = network.current()->piece_values(pos);
+    PieceValues                   result{UCIEngine::to_cp(pv.eval, pos), {}};
+
+    for (Square s = SQ_A0; s <= SQ_I9; ++s)
+        if (is_valid(pv.values[s]))
+            result.pieces.push_back({s, pos.piece_on(s), UCIEngine::to_cp(pv.values[s], pos)});
+
+    return result;
 }
 
 const OptionsMap& Engine::get_options() const { return options; }
@@ -225,7 +725,13 @@ OptionsMap&       Engine::get_options() { return options; }
 
 std::string Engine::fen() const { return pos.fen(); }
 
-void Engine::flip() { pos.flip(); }
+void Engine::flip() {
+    pos.flip();
+
+    // The moves leading to the flipped position are lost
+    positionFen = pos.fen();
+    positionMoves.clear();
+}
 
 std::string Engine::visualize() const {
     std::stringstream ss;
@@ -235,6 +741,21 @@ std::string Engine::visualize() const {
 
 int Engine::get_hashfull(int maxAge) const { return tt.hashfull(maxAge); }
 
+std::string Engine::hash_stats() {
+    wait_for_search_finished();
+
+    std::stringstream ss;
+    ss << tt.stats(threads);
+    return ss.str();
+}
+
+void Engine::start_perf_counters() {
+    wait_for_search_finished();
+    threads.start_perf_counters();
+}
+
+PerfCounters::Sample Engine::stop_perf_counters() { return threads.stop_perf_counters(); }
+
 std::vector<std::pair<size_t, size_t>> Engine::get_bound_thread_count_by_numa_node() const {
     auto                                   counts = threads.get_bound_thread_count_by_numa_node();
     const NumaConfig&                      cfg    = numaContext.get_numa_config();
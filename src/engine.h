@@ -28,8 +28,10 @@
 #include <utility>
 #include <vector>
 
+#include "gamerecord.h"
 #include "nnue/network.h"
 #include "numa.h"
+#include "perfcounters.h"
 #include "position.h"
 #include "search.h"
 #include "thread.h"
@@ -56,16 +58,42 @@ class Engine {
     ~Engine() { wait_for_search_finished(); }
 
     std::uint64_t perft(const std::string& fen, Depth depth);
+    // blocking call counting the perft of every (fen, depth) pair on the search threads
+    std::vector<std::uint64_t> perft_batch(const std::vector<std::pair<std::string, Depth>>& jobs);
+    // blocking call searching every (fen, moves) position on its own, one per thread at a time
+    std::vector<Search::BatchResult>
+    search_batch(const std::vector<ThreadPool::BatchJob>& jobs,
+                 const Search::LimitsType&                limits,
+                 size_t                                   concurrency = 0,
+                 const ThreadPool::BatchIteration&        onIteration = {});
+
+    // blocking call converting a file of game records, parsed on the search threads
+    GameRecord::ImportStats
+    import_games(const std::string& input, const std::string& output, GameRecord::Format format);
 
     // non blocking call to start searching
     void go(Search::LimitsType&);
     // non blocking call to stop searching
     void stop();
 
+    // blocking call to stop searching without reporting a best move, keeping
+    // the search state so it can be continued later, returns false if idle
+    bool suspend();
+    // non blocking call to continue the most recently suspended search
+    bool resume();
+    bool can_suspend() const;
+    // blocking call that suspends the running search, if any, searches the
+    // current position with the given limits and then resumes the former.
+    // Returns false, without searching, if the running search can't be
+    // suspended because another one already is.
+    bool go_priority(Search::LimitsType&);
+
     // blocking call to wait for search to finish
     void wait_for_search_finished();
     // set a new position, moves are in UCI format
     void set_position(const std::string& fen, const std::vector<std::string>& moves);
+    // the arguments of the last set_position(), to set the same position again
+    std::pair<std::string, std::vector<std::string>> position_setup() const;
 
     // modifiers
 
@@ -75,6 +103,10 @@ class Engine {
     void set_ponderhit(bool);
     void search_clear();
 
+    // histories persisted between processes, see History File
+    std::string save_history(const std::string& file);
+    std::string load_history(const std::string& file);
+
     void set_on_update_no_moves(std::function<void(const InfoShort&)>&&);
     void set_on_update_full(std::function<void(const InfoFull&)>&&);
     void set_on_iter(std::function<void(const InfoIter&)>&&);
@@ -84,17 +116,40 @@ class Engine {
     // network related
 
     void verify_network() const;
-    void load_network(const std::string& file);
+    // loads the network, during a search it is swapped in without stopping it
+    std::optional<std::string> load_network(const std::string& file);
     void save_network(const std::optional<std::string>& file);
+    // lays out the feature transformer rows by their frequency in a game file
+    std::optional<std::string> set_feature_profile(const std::string& path);
 
     // utility functions
 
     void trace_eval() const;
 
+    struct PieceValue {
+        Square sq;
+        Piece  pc;
+        int    cp;
+    };
+
+    struct PieceValues {
+        int                     eval;
+        std::vector<PieceValue> pieces;
+    };
+
+    // NNUE evaluation of the current position and value of each of its pieces
+    // but the kings, in centipawns from White's point of view. None in check.
+    std::optional<PieceValues> piece_values() const;
+
     const OptionsMap& get_options() const;
     OptionsMap&       get_options();
 
-    int get_hashfull(int maxAge = 0) const;
+    int         get_hashfull(int maxAge = 0) const;
+    std::string hash_stats();
+
+    // hardware performance counters of the search threads, Linux only
+    void                 start_perf_counters();
+    PerfCounters::Sample stop_perf_counters();
 
     std::string                            fen() const;
     void                                   flip();
@@ -104,22 +159,44 @@ class Engine {
     std::string                            numa_config_information_as_string() const;
     std::string                            thread_allocation_information_as_string() const;
     std::string                            thread_binding_information_as_string() const;
+    std::string                            memory_information_as_string() const;
 
    private:
     const std::string binaryDirectory;
 
     NumaReplicationContext numaContext;
 
-    Position     pos;
-    StateListPtr states;
+    Position                 pos;
+    StateListPtr             states;
+    std::string              positionFen;
+    std::vector<std::string> positionMoves;
 
-    OptionsMap                              options;
-    ThreadPool                              threads;
-    TranspositionTable                      tt;
-    LazyNumaReplicated<Eval::NNUE::Network> network;
+    OptionsMap                                        options;
+    ThreadPool                                        threads;
+    TranspositionTable                                tt;
+    DoubleBufferedNumaReplicated<Eval::NNUE::Network> network;
+
+    // Network loaded during the last search, reported by the next one
+    TimePoint networkPublished = 0, networkLoadTime = 0;
 
     Search::SearchManager::UpdateContext  updateContext;
     std::function<void(std::string_view)> onVerifyNetworks;
+
+    void finish_network_swap();
+    void warm_start_histories();
+
+    // Memory used by everything but the transposition table, see MemoryBudget
+    struct MemoryUsage {
+        size_t perThread, threads, perReplica, replicas, bestFirstTree, reserve;
+
+        size_t total() const {
+            return perThread * threads + perReplica * replicas + bestFirstTree + reserve;
+        }
+    };
+
+    MemoryUsage           memory_usage() const;
+    std::optional<size_t> memory_budget() const;
+    size_t                hash_within_budget(size_t mb) const;
 };
 
 }  // namespace Stockfish
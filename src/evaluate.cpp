@@ -26,6 +26,7 @@
 #include <memory>
 #include <sstream>
 
+#include "endgame.h"
 #include "nnue/network.h"
 #include "nnue/nnue_misc.h"
 #include "position.h"
@@ -46,6 +47,10 @@ Value Eval::evaluate(const Eval::NNUE::Network& network,
 
     assert(!pos.checkers());
 
+    // Known endgames are evaluated exactly, without NNUE
+    if (const Endgames::Endgame* eg = Endgames::probe(pos.material_key()))
+        return eg->evaluate(pos, eg->strongSide);
+
     auto [psqt, positional] = network.evaluate(pos, &caches.cache);
     Value nnue              = psqt + positional;
     int   nnueComplexity    = std::abs(psqt - positional);
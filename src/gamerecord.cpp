@@ -0,0 +1,594 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gamerecord.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "position.h"
+#include "thread.h"
+#include "uci.h"
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define USE_MMAP
+#endif
+
+namespace Stockfish::GameRecord {
+
+namespace {
+
+constexpr auto StartFEN = "rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C5C1/9/RNBAKABNR w";
+
+// Games parsed by a thread before it hands its output over to the writer
+constexpr size_t ChunkSize = 256;
+
+// Errors kept for the report, the others are only counted
+constexpr size_t MaxErrors = 10;
+
+bool is_blank(std::string_view line) {
+    return std::all_of(line.begin(), line.end(), [](char c) { return std::isspace(c); });
+}
+
+// Returns the next line of 'text' without its end of line, and removes it
+std::string_view next_line(std::string_view& text) {
+    size_t           end  = text.find('\n');
+    std::string_view line = text.substr(0, end);
+
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+
+    return line;
+}
+
+std::string_view next_token(std::string_view& line) {
+    size_t begin = 0;
+    while (begin < line.size() && std::isspace(line[begin]))
+        ++begin;
+
+    size_t end = begin;
+    while (end < line.size() && !std::isspace(line[end]))
+        ++end;
+
+    std::string_view token = line.substr(begin, end - begin);
+    line.remove_prefix(end);
+    return token;
+}
+
+bool is_result(std::string_view token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool is_iccs(std::string_view token) {
+    return (token.size() == 4 && std::isalpha(token[2]))
+        || (token.size() == 5 && token[2] == '-');
+}
+
+PieceType wxf_piece(char c) {
+    switch (std::toupper(c))
+    {
+    case 'K' :
+        return KING;
+    case 'A' :
+        return ADVISOR;
+    case 'B' :
+    case 'E' :
+        return BISHOP;
+    case 'N' :
+    case 'H' :
+        return KNIGHT;
+    case 'R' :
+        return ROOK;
+    case 'C' :
+        return CANNON;
+    case 'P' :
+        return PAWN;
+    default :
+        return NO_PIECE_TYPE;
+    }
+}
+
+// WXF files are numbered from 1 to 9 from the right of the side to move
+int wxf_file(Square s, Color us) { return us == WHITE ? FILE_I - file_of(s) + 1 : file_of(s) + 1; }
+
+// Ranks gained by a move, from the point of view of the side to move
+int forward_ranks(Square from, Square to, Color us) {
+    return us == WHITE ? rank_of(to) - rank_of(from) : rank_of(from) - rank_of(to);
+}
+
+void put_u16(std::string& out, unsigned v) {
+    out += char(v & 0xFF);
+    out += char((v >> 8) & 0xFF);
+}
+
+void write_game(std::string& out, const Game& game, Format format) {
+
+    if (format == Format::Binary)
+    {
+        put_u16(out, unsigned(game.fen.size()));
+        out += game.fen;
+        put_u16(out, unsigned(game.moves.size()));
+
+        for (Move m : game.moves)
+            put_u16(out, m.raw());
+
+        return;
+    }
+
+    out += "fen ";
+    out += game.fen;
+
+    if (!game.moves.empty())
+        out += " moves";
+
+    for (Move m : game.moves)
+    {
+        out += ' ';
+        out += UCIEngine::move(m);
+    }
+
+    out += '\n';
+}
+
+}  // namespace
+
+
+MappedFile::MappedFile(const std::string& path) {
+
+#ifdef USE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+    {
+        size = size_t(st.st_size);
+        open = true;
+
+        if (size)
+        {
+            void* mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mem != MAP_FAILED)
+            {
+                data   = static_cast<const char*>(mem);
+                mapped = true;
+            }
+            else
+                open = false;
+        }
+    }
+
+    // The mapping stays valid once the file is closed
+    ::close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return;
+
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+    open = true;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef USE_MMAP
+    if (mapped)
+        munmap(const_cast<char*>(data), size);
+#endif
+}
+
+
+Move from_iccs(const Position& pos, std::string_view str) {
+
+    if (!is_iccs(str))
+        return Move::none();
+
+    char c[4];
+    for (size_t i = 0, j = 0; i < str.size() && j < 4; ++i)
+        if (str[i] != '-')
+            c[j++] = char(std::tolower(str[i]));
+
+    if (c[0] < 'a' || c[0] > 'i' || c[2] < 'a' || c[2] > 'i'
+        || !std::isdigit(c[1]) || !std::isdigit(c[3]))
+        return Move::none();
+
+    const Square from = make_square(File(c[0] - 'a'), Rank(c[1] - '0'));
+    const Square to   = make_square(File(c[2] - 'a'), Rank(c[3] - '0'));
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+        if (m.from_sq() == from && m.to_sq() == to)
+            return m;
+
+    return Move::none();
+}
+
+// The piece is given either by its file, as in "C2.5", or when two pieces of
+// the same type stand on one file by '+' for the front one and '-' for the rear
+// one, before or after its letter as in "+R.4" or "R+.4". Rooks, cannons, pawns
+// and kings moving along a file give the number of ranks they move, the other
+// moves give the destination file.
+Move from_wxf(const Position& pos, std::string_view str) {
+
+    if (str.size() != 4)
+        return Move::none();
+
+    size_t i      = 0;
+    int    tandem = 0;  // 1 for the front piece, -1 for the rear one
+
+    if (str[0] == '+' || str[0] == '-')
+        tandem = str[i++] == '+' ? 1 : -1;
+
+    const PieceType pt   = wxf_piece(str[i++]);
+    int             file = 0;
+
+    if (!tandem && std::isdigit(str[i]))
+        file = str[i++] - '0';
+    else if (!tandem && (str[i] == '+' || str[i] == '-'))
+        tandem = str[i++] == '+' ? 1 : -1;
+
+    const char op = str[i++];
+
+    if (pt == NO_PIECE_TYPE || i != 3 || !std::isdigit(str[3])
+        || (op != '+' && op != '-' && op != '.' && op != '='))
+        return Move::none();
+
+    const int   n        = str[3] - '0';
+    const bool  straight = pt == ROOK || pt == CANNON || pt == PAWN || pt == KING;
+    const bool  sideways = op == '.' || op == '=';
+    const int   dir      = sideways ? 0 : op == '+' ? 1 : -1;
+    const Color us       = pos.side_to_move();
+
+    Move found = Move::none();
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        const Square from = m.from_sq(), to = m.to_sq();
+
+        if (type_of(pos.moved_piece(m)) != pt)
+            continue;
+
+        if (file && wxf_file(from, us) != file)
+            continue;
+
+        if (tandem)
+        {
+            // The piece must have a twin on its file, behind it for the front one
+            bool twin = false, ahead = false;
+
+            for (Bitboard b = pos.pieces(us, pt) & file_bb(from); b;)
+            {
+                Square s = pop_lsb(b);
+                int    d = forward_ranks(from, s, us);
+                twin |= d != 0;
+                ahead |= tandem * d > 0;
+            }
+
+            if (!twin || ahead)
+                continue;
+        }
+
+        const int ranks = forward_ranks(from, to, us);
+
+        if ((ranks > 0) - (ranks < 0) != dir)
+            continue;
+
+        if (straight && !sideways)
+        {
+            if (std::abs(ranks) != n || file_of(from) != file_of(to))
+                continue;
+        }
+        else if (wxf_file(to, us) != n)
+            continue;
+
+        // Ambiguous, e.g. three pawns on a file
+        if (found != Move::none())
+            return Move::none();
+
+        found = m;
+    }
+
+    return found;
+}
+
+Move from_notation(const Position& pos, std::string_view str) {
+    return is_iccs(str) ? from_iccs(pos, str) : from_wxf(pos, str);
+}
+
+
+std::vector<std::string_view> split_games(std::string_view text) {
+
+    std::vector<std::string_view> games;
+    const char*                   begin    = nullptr;  // Start of the current game
+    bool                          tagged   = false;
+    bool                          movetext = false;
+
+    auto finish = [&](const char* end) {
+        if (begin)
+            games.emplace_back(begin, size_t(end - begin));
+
+        begin  = nullptr;
+        tagged = movetext = false;
+    };
+
+    while (!text.empty())
+    {
+        const char*      lineStart = text.data();
+        std::string_view line      = next_line(text);
+        const char*      lineEnd   = line.data() + line.size();
+
+        if (is_blank(line))
+        {
+            if (movetext)
+                finish(lineStart);
+            continue;
+        }
+
+        size_t first = line.find_first_not_of(" \t");
+
+        if (line[first] == '[')
+        {
+            if (movetext)
+                finish(lineStart);
+
+            if (!begin)
+                begin = lineStart;
+
+            tagged = true;
+            continue;
+        }
+
+        if (!begin)
+            begin = lineStart;
+
+        movetext = true;
+
+        // Without tag pairs every line is a game
+        if (!tagged)
+            finish(lineEnd);
+    }
+
+    finish(text.data());
+    return games;
+}
+
+
+Game parse_game(std::string_view text) {
+
+    Game                          game;
+    std::vector<std::string_view> tokens;
+    bool                          comment = false, result = false;
+    int                           variation = 0;
+
+    game.fen = StartFEN;
+
+    while (!text.empty() && !result)
+    {
+        std::string_view line  = next_line(text);
+        size_t           first = line.find_first_not_of(" \t");
+
+        if (first == std::string_view::npos)
+            continue;
+
+        if (line[first] == '[' && !comment)
+        {
+            size_t q1 = line.find('"'), q2 = line.rfind('"');
+            if (line.substr(first + 1, 4) == "FEN " && q1 < q2 && q2 != std::string_view::npos)
+                game.fen = std::string(line.substr(q1 + 1, q2 - q1 - 1));
+            continue;
+        }
+
+        for (std::string_view token; !(token = next_token(line)).empty();)
+        {
+            if (comment)
+            {
+                comment = token.find('}') == std::string_view::npos;
+                continue;
+            }
+
+            if (token[0] == '{')
+            {
+                comment = token.find('}') == std::string_view::npos;
+                continue;
+            }
+
+            if (token[0] == ';')
+                break;
+
+            if (variation || token[0] == '(')
+            {
+                variation += int(std::count(token.begin(), token.end(), '('))
+                           - int(std::count(token.begin(), token.end(), ')'));
+                continue;
+            }
+
+            if (is_result(token))
+            {
+                result = true;
+                break;
+            }
+
+            // Move numbers, also when glued to the move as in "1.h2e2"
+            size_t digits = 0;
+            while (digits < token.size() && std::isdigit(token[digits]))
+                ++digits;
+
+            if (digits && digits < token.size() && token[digits] == '.')
+            {
+                size_t move = token.find_first_not_of('.', digits);
+                if (move == std::string_view::npos)
+                    continue;
+
+                token.remove_prefix(move);
+            }
+
+            // Annotation symbols
+            while (!token.empty()
+                   && (token.back() == '!' || token.back() == '?' || token.back() == '#'))
+                token.remove_suffix(1);
+
+            if (!token.empty())
+                tokens.push_back(token);
+        }
+    }
+
+    // The moves are only made, never retracted, and do_move() reads no further
+    // back than the previous state, so a ring of three states is enough.
+    StateInfo states[3];
+    Position  pos;
+    pos.set(game.fen, &states[0]);
+    game.fen = pos.fen();
+
+    for (std::string_view token : tokens)
+    {
+        Move m = from_notation(pos, token);
+
+        if (m == Move::none())
+        {
+            game.error = "illegal move " + std::string(token) + " at ply "
+                       + std::to_string(game.moves.size() + 1);
+            break;
+        }
+
+        pos.do_move(m, states[(game.moves.size() + 1) % 3]);
+        game.moves.push_back(m);
+    }
+
+    return game;
+}
+
+
+ImportStats import(ThreadPool&        threads,
+                   const std::string& input,
+                   const std::string& output,
+                   Format             format) {
+
+    ImportStats stats;
+    MappedFile  in(input);
+
+    if (!in.is_open())
+    {
+        stats.failure = "Unable to open file " + input;
+        return stats;
+    }
+
+    std::ofstream out(output, std::ios::binary);
+
+    if (!out)
+    {
+        stats.failure = "Unable to write file " + output;
+        return stats;
+    }
+
+    const std::vector<std::string_view> games  = split_games(in.view());
+    const size_t                        chunks = (games.size() + ChunkSize - 1) / ChunkSize;
+
+    struct Chunk {
+        std::string              out;
+        size_t                   invalid = 0;
+        uint64_t                 moves   = 0;
+        std::vector<std::string> errors;
+        bool                     done = false;
+    };
+
+    std::vector<Chunk>      results(chunks);
+    std::mutex              mutex;
+    std::condition_variable cv;
+    std::atomic<size_t>     next(0);
+
+    for (size_t i = 0; i < threads.num_threads(); ++i)
+        threads.run_on_thread(i, [&]() {
+            for (size_t c; (c = next++) < chunks;)
+            {
+                Chunk chunk;
+
+                for (size_t g = c * ChunkSize; g < std::min(games.size(), (c + 1) * ChunkSize); ++g)
+                {
+                    Game game = parse_game(games[g]);
+
+                    if (!game.error.empty())
+                    {
+                        ++chunk.invalid;
+                        if (chunk.errors.size() < MaxErrors)
+                            chunk.errors.push_back("game " + std::to_string(g + 1) + ": "
+                                                   + game.error);
+                    }
+
+                    chunk.moves += game.moves.size();
+                    write_game(chunk.out, game, format);
+                }
+
+                chunk.done = true;
+
+                {
+                    std::lock_guard<std::mutex> lk(mutex);
+                    results[c] = std::move(chunk);
+                }
+
+                cv.notify_one();
+            }
+        });
+
+    // The calling thread writes the chunks in order, as soon as they are ready
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        std::unique_lock<std::mutex> lk(mutex);
+        cv.wait(lk, [&] { return results[c].done; });
+        Chunk chunk = std::move(results[c]);
+        lk.unlock();
+
+        out.write(chunk.out.data(), std::streamsize(chunk.out.size()));
+
+        stats.invalid += chunk.invalid;
+        stats.moves += chunk.moves;
+
+        for (auto& e : chunk.errors)
+            if (stats.errors.size() < MaxErrors)
+                stats.errors.push_back(std::move(e));
+    }
+
+    for (size_t i = 0; i < threads.num_threads(); ++i)
+        threads.wait_on_thread(i);
+
+    stats.games = games.size();
+
+    if (!out.flush())
+        stats.failure = "Error writing file " + output;
+
+    return stats;
+}
+
+}  // namespace Stockfish::GameRecord
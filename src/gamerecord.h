@@ -0,0 +1,106 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMERECORD_H_INCLUDED
+#define GAMERECORD_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+class ThreadPool;
+
+namespace GameRecord {
+
+// A read only view of a whole file, memory mapped where supported and read
+// into memory otherwise.
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool             is_open() const { return open; }
+    std::string_view view() const { return {data, size}; }
+
+   private:
+    const char* data   = nullptr;
+    size_t      size   = 0;
+    bool        open   = false;
+    bool        mapped = false;
+    std::string contents;
+};
+
+// Decode a move given in ICCS ("h2e2", "H2-E2") or in WXF ("C2.5", "H8+7",
+// "+R.4") notation. Move::none() is returned if the move is not legal.
+Move from_iccs(const Position& pos, std::string_view str);
+Move from_wxf(const Position& pos, std::string_view str);
+
+// Either of the above, depending on the form of the move
+Move from_notation(const Position& pos, std::string_view str);
+
+// Splits a game record file into its games. A game is either a line of moves,
+// or a PGN like game made of tag pairs followed by its movetext, which ends at
+// the next blank line or tag pair.
+std::vector<std::string_view> split_games(std::string_view text);
+
+// A game decoded and validated move by move. The moves are the legal prefix of
+// the game, 'error' tells why the rest of it was dropped.
+struct Game {
+    std::string       fen;
+    std::vector<Move> moves;
+    std::string       error;
+};
+
+Game parse_game(std::string_view text);
+
+enum class Format {
+    Text,   // One "fen <fen> moves <moves>" line per game, in ICCS notation
+    Binary  // Per game, the length of the fen and the fen, then the number of
+            // moves and the moves, the integers as 16 bit little endian.
+};
+
+struct ImportStats {
+    size_t                   games    = 0;
+    size_t                   invalid  = 0;
+    uint64_t                 moves    = 0;
+    std::vector<std::string> errors;  // The first errors only, with their game number
+    std::string              failure;  // Set if the files could not be opened
+};
+
+// Converts the games of 'input' to 'output', parsing them in parallel on the
+// search threads. The games keep their order in the output.
+ImportStats import(ThreadPool&        threads,
+                   const std::string& input,
+                   const std::string& output,
+                   Format             format);
+
+}  // namespace GameRecord
+
+}  // namespace Stockfish
+
+#endif  // #ifndef GAMERECORD_H_INCLUDED
@@ -20,6 +20,7 @@
 #include <string>
 
 #include "bitboard.h"
+#include "endgame.h"
 #include "misc.h"
 #include "position.h"
 #include "uci.h"
@@ -33,6 +34,7 @@ int main(int argc, char* argv[]) {
 
     Bitboards::init();
     Position::init();
+    Endgames::init();
 
     UCIEngine uci(argc, argv);
 
@@ -0,0 +1,227 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mcts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "memory.h"
+
+namespace Stockfish::MCTS {
+
+namespace {
+
+// Fixed point unit of the value sums
+constexpr double ScoreOne = 1 << 16;
+
+// Scale of the logistic mapping between values and scores
+constexpr double ValueScale = 300;
+
+// Exploration constant, and first play urgency: unvisited children are
+// assumed to score this much less than their parent.
+constexpr double Cpuct        = 1.5;
+constexpr double FpuReduction = 0.2;
+
+// Priors decrease geometrically with the rank of the move in MovePicker order
+constexpr double PriorDecay = 0.8;
+
+}  // namespace
+
+
+double to_score(Value v) {
+
+    if (is_win(v))
+        return 1;
+    if (is_loss(v))
+        return -1;
+
+    return std::tanh(v / (2 * ValueScale));
+}
+
+Value to_value(double score) {
+
+    score = std::clamp(score, -0.999, 0.999);
+
+    Value v = Value(std::lround(ValueScale * std::log((1 + score) / (1 - score))));
+
+    return std::clamp(v, VALUE_MATED_IN_MAX_PLY + 1, VALUE_MATE_IN_MAX_PLY - 1);
+}
+
+
+double Node::q() const {
+
+    uint32_t n = visits.load(std::memory_order_relaxed);
+    return n ? valueSum.load(std::memory_order_relaxed) / ScoreOne / n : 0;
+}
+
+
+Tree::~Tree() { release(); }
+
+void Tree::release() {
+
+    aligned_large_pages_free(nodes);
+
+    nodes    = nullptr;
+    capacity = 0;
+    used     = 0;
+}
+
+// Sets the size of the arena, measured in megabytes
+void Tree::resize(size_t mbSize) {
+
+    size_t newCapacity = mbSize * 1024 * 1024 / sizeof(Node);
+
+    if (newCapacity == capacity)
+        return;
+
+    aligned_large_pages_free(nodes);
+
+    capacity = newCapacity;
+    nodes    = static_cast<Node*>(aligned_large_pages_alloc(capacity * sizeof(Node)));
+
+    if (!nodes)
+    {
+        std::cerr << "Failed to allocate " << mbSize << "MB for the best-first search tree."
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    clear();
+}
+
+// Drops the tree, leaving only an unexpanded root
+void Tree::clear() {
+
+    new (nodes) Node(Move::none(), 1);
+    used = 1;
+}
+
+
+Node* Tree::select(Node& node) const {
+
+    const uint32_t parentVisits = node.visits.load(std::memory_order_relaxed)
+                                + node.virtualLoss.load(std::memory_order_relaxed);
+    const double sqrtVisits = std::sqrt(double(std::max(parentVisits, 1u)));
+    const double fpu        = -node.q() - FpuReduction;
+
+    Node*  best      = node.begin();
+    double bestScore = -2;
+
+    for (Node& child : node)
+    {
+        uint32_t n  = child.visits.load(std::memory_order_relaxed);
+        uint32_t vl = child.virtualLoss.load(std::memory_order_relaxed);
+
+        // A virtual loss counts as a lost visit
+        double q = n + vl ? (child.valueSum.load(std::memory_order_relaxed) / ScoreOne - vl)
+                              / (n + vl)
+                          : fpu;
+        double score = q + Cpuct * child.prior * sqrtVisits / (1 + n + vl);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best      = &child;
+        }
+    }
+
+    best->virtualLoss.fetch_add(1, std::memory_order_relaxed);
+    return best;
+}
+
+
+bool Tree::expand(Node& node, const std::vector<Move>& moves) {
+
+    Node::State expected = Node::LEAF;
+
+    if (!node.state.compare_exchange_strong(expected, Node::EXPANDING, std::memory_order_acquire))
+        return false;
+
+    size_t first = used.fetch_add(moves.size(), std::memory_order_relaxed);
+
+    if (first + moves.size() > capacity)
+    {
+        node.state.store(Node::LEAF, std::memory_order_relaxed);
+        return false;
+    }
+
+    double sum = 0, prior = 1;
+    for (size_t i = 0; i < moves.size(); ++i, prior *= PriorDecay)
+        sum += prior;
+
+    prior = 1;
+    for (size_t i = 0; i < moves.size(); ++i, prior *= PriorDecay)
+        new (&nodes[first + i]) Node(moves[i], float(prior / sum));
+
+    node.children   = &nodes[first];
+    node.childCount = uint16_t(moves.size());
+    node.state.store(Node::EXPANDED, std::memory_order_release);
+
+    return true;
+}
+
+
+void Tree::backup(Node* const* path, int length, double score) {
+
+    // The score of the side to move at a node is the opposite of the score of
+    // the side that moved into it.
+    for (int i = length - 1; i >= 0; --i)
+    {
+        score = -score;
+
+        path[i]->valueSum.fetch_add(int64_t(score * ScoreOne), std::memory_order_relaxed);
+        path[i]->visits.fetch_add(1, std::memory_order_relaxed);
+
+        if (i > 0)
+            path[i]->virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+
+void Tree::revert(Node* const* path, int length) {
+
+    for (int i = 1; i < length; ++i)
+        path[i]->virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+std::vector<Move> Tree::pv(const Node& node) const {
+
+    std::vector<Move> line{node.move};
+
+    for (const Node* n = &node; n->expanded();)
+    {
+        n = std::max_element(n->begin(), n->end(), [](const Node& a, const Node& b) {
+            return a.visits.load(std::memory_order_relaxed)
+                 < b.visits.load(std::memory_order_relaxed);
+        });
+
+        if (!n->visits.load(std::memory_order_relaxed))
+            break;
+
+        line.push_back(n->move);
+    }
+
+    return line;
+}
+
+}  // namespace Stockfish::MCTS
@@ -0,0 +1,118 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MCTS_H_INCLUDED
+#define MCTS_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+
+namespace Stockfish::MCTS {
+
+// Maps a search value to an expected score in [-1, 1], and back
+double to_score(Value v);
+Value  to_value(double score);
+
+// A node of the best-first search tree. All the threads update the statistics
+// without locks. The value sum is the sum of the scores backed up through the
+// node, from the point of view of the side that played 'move', in fixed point
+// so that it can be updated atomically.
+struct Node {
+    enum State : uint8_t {
+        LEAF,
+        EXPANDING,
+        EXPANDED
+    };
+
+    Node(Move m, float p) :
+        move(m),
+        prior(p) {}
+
+    bool   expanded() const { return state.load(std::memory_order_acquire) == EXPANDED; }
+    double q() const;
+
+    Node* begin() const { return children; }
+    Node* end() const { return children + childCount; }
+
+    std::atomic<uint32_t> visits{0};
+    std::atomic<uint32_t> virtualLoss{0};
+    std::atomic<int64_t>  valueSum{0};
+    std::atomic<State>    state{LEAF};
+
+    // Written once by the thread expanding the node, before it is published
+    Node*    children   = nullptr;
+    uint16_t childCount = 0;
+
+    Move  move;
+    float prior;
+};
+
+// The tree of the "BestFirst" parallel search, shared by all the threads. It
+// is a PUCT tree: moves are selected by their average score plus an exploration
+// term proportional to their prior. Threads descending through a node count a
+// virtual loss on it until they back up their result, so that they spread over
+// different lines. The nodes are taken from a fixed size arena, once it is
+// full the tree stops growing.
+class Tree {
+   public:
+    Tree() = default;
+    ~Tree();
+
+    Tree(const Tree&)            = delete;
+    Tree& operator=(const Tree&) = delete;
+
+    void resize(size_t mbSize);
+    void clear();
+    void release();  // Frees the arena until the next resize()
+
+    Node* root() const { return nodes; }
+    bool  full() const { return used.load(std::memory_order_relaxed) >= capacity; }
+    bool  empty() const { return !nodes; }
+
+    // Returns the child with the best PUCT score and adds a virtual loss to it
+    Node* select(Node& node) const;
+
+    // Creates the children of the node, the moves being in the order in which
+    // they should be tried. Fails if another thread is already expanding the
+    // node or if the arena is full.
+    bool expand(Node& node, const std::vector<Move>& moves);
+
+    // Backs up the score of the last node of the path, seen from its side to
+    // move, and removes the virtual losses added while selecting the path.
+    void backup(Node* const* path, int length, double score);
+
+    // Only removes the virtual losses of the path, for a leaf whose evaluation
+    // was abandoned and so must not count as a visit.
+    void revert(Node* const* path, int length);
+
+    // The most visited line starting with the move of the node
+    std::vector<Move> pv(const Node& node) const;
+
+   private:
+    Node*               nodes    = nullptr;
+    size_t              capacity = 0;
+    std::atomic<size_t> used{0};
+};
+
+}  // namespace Stockfish::MCTS
+
+#endif  // #ifndef MCTS_H_INCLUDED
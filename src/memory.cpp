@@ -19,6 +19,8 @@
 #include "memory.h"
 
 #include <cstdlib>
+#include <fstream>
+#include <string>
 
 #if __has_include("features.h")
     #include <features.h>
@@ -244,6 +246,62 @@ bool has_large_pages() {
 }
 
 
+std::optional<size_t> cgroup_memory_limit() {
+
+#if defined(__linux__)
+
+    std::optional<size_t> limit;
+
+    // Reads a limit, either "max" or a number of bytes. Unlimited cgroup v1
+    // groups report a number close to the largest 64 bit value instead.
+    auto read_limit = [&](const std::string& file) {
+        std::ifstream      in(file);
+        unsigned long long bytes;
+
+        if (in >> bytes && bytes < (1ULL << 60))
+            limit = std::min(limit.value_or(size_t(-1)), size_t(bytes));
+    };
+
+    // Lines of /proc/self/cgroup are "id:controllers:path", cgroup v2 being
+    // "0::path" and the memory controller of cgroup v1 "id:memory:path".
+    std::ifstream cgroup("/proc/self/cgroup");
+
+    for (std::string line; std::getline(cgroup, line);)
+    {
+        size_t c1 = line.find(':'), c2 = line.find(':', c1 + 1);
+        if (c2 == std::string::npos)
+            continue;
+
+        std::string controllers = line.substr(c1 + 1, c2 - c1 - 1);
+        std::string path        = line.substr(c2 + 1);
+        std::string root, file;
+
+        if (controllers.empty())
+            root = "/sys/fs/cgroup", file = "/memory.max";
+        else if (controllers == "memory")
+            root = "/sys/fs/cgroup/memory", file = "/memory.limit_in_bytes";
+        else
+            continue;
+
+        // The limit of a group also applies to its descendants
+        for (;; path.erase(path.rfind('/')))
+        {
+            read_limit(root + path + file);
+            if (path.find('/') == std::string::npos)
+                break;
+        }
+    }
+
+    return limit;
+
+#else
+
+    return std::nullopt;
+
+#endif
+}
+
+
 // aligned_large_pages_free() will free the previously memory allocated
 // by aligned_large_pages_alloc(). The effect is a nop if mem == nullptr.
 
@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <memory>
 #include <new>
+#include <optional>
 #include <type_traits>
 #include <utility>
 
@@ -40,6 +41,11 @@ void  aligned_large_pages_free(void* mem);
 
 bool has_large_pages();
 
+// The memory limit of the cgroup of the process in bytes, from memory.max of
+// cgroup v2 or memory.limit_in_bytes of cgroup v1, the lowest one along the
+// path of the cgroup. Linux only, std::nullopt if there is no limit.
+std::optional<size_t> cgroup_memory_limit();
+
 // Frees memory which was placed there with placement new.
 // Works for both single objects and arrays of unknown bound.
 template<typename T, typename FREE_FUNC>
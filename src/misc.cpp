@@ -22,16 +22,23 @@
 #include <atomic>
 #include <cassert>
 #include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string_view>
+#include <thread>
+#include <utility>
 
 #include "types.h"
 #include "external/zstd.h"
@@ -48,67 +55,254 @@ constexpr std::string_view version = "dev";
 // can toggle the logging of std::cout and std:cin at runtime whilst preserving
 // usual I/O functionality, all without changing a single line of code!
 // Idea from http://groups.google.com/group/comp.lang.c++/msg/1d941c0f26ea0d81
+//
+// The Tie objects only collect whole lines, which are handed over to a writer
+// thread through a bounded lock-free queue, so that neither the search threads
+// nor the UCI loop ever wait for the file system.
+
+// Bounded multi-producer queue of log lines, after Dmitry Vyukov's MPMC queue.
+// The producers are the threads writing to std::cout and the one reading from
+// std::cin, the single consumer is the writer thread. Strings are swapped in
+// and out of the slots, so their buffers are recycled instead of reallocated.
+class LogQueue {
+
+    static constexpr size_t Capacity = 4096;  // Has to be a power of 2
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        std::string         line;
+        int64_t             time;  // Milliseconds since epoch, as given to push()
+    };
+
+   public:
+    LogQueue() :
+        slots(std::make_unique<Slot[]>(Capacity)) {
+        for (size_t i = 0; i < Capacity; ++i)
+            slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // Returns false if the queue is full, 'line' is left untouched then
+    bool try_push(std::string& line, int64_t time) {
+
+        size_t pos = tail.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Slot&          slot = slots[pos & (Capacity - 1)];
+            const size_t   seq  = slot.seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+
+            if (diff < 0)
+                return false;
+
+            if (diff > 0)
+                pos = tail.load(std::memory_order_relaxed);
+
+            else if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                std::swap(slot.line, line);
+                slot.time = time;
+                slot.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    // Only to be called by the consumer
+    bool try_pop(std::string& line, int64_t& time) {
+
+        Slot& slot = slots[head & (Capacity - 1)];
+
+        if (slot.seq.load(std::memory_order_acquire) != head + 1)
+            return false;
+
+        std::swap(slot.line, line);
+        time = slot.time;
+        slot.seq.store(head + Capacity, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+   private:
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) size_t head = 0;
+};
 
 struct Tie: public std::streambuf {  // MSVC requires split streambuf for cin and cout
 
-    Tie(std::streambuf* b, std::streambuf* l) :
+    Tie(std::streambuf* b, LogQueue& q, const char* p) :
         buf(b),
-        logBuf(l) {}
+        queue(q),
+        prefix(p) {}
 
-    int sync() override { return logBuf->pubsync(), buf->pubsync(); }
-    int overflow(int c) override { return log(buf->sputc(char(c)), "<< "); }
+    int sync() override { return buf->pubsync(); }
+    int overflow(int c) override { return log(buf->sputc(char(c))); }
     int underflow() override { return buf->sgetc(); }
-    int uflow() override { return log(buf->sbumpc(), ">> "); }
+    int uflow() override { return log(buf->sbumpc()); }
+
+    std::streambuf* buf;
+    LogQueue&       queue;
+    const char*     prefix;
+    std::string     line;
+
+    int log(int c) {
 
-    std::streambuf *buf, *logBuf;
+        if (c == EOF)
+            return c;
 
-    int log(int c, const char* prefix) {
+        if (line.empty())
+            line = prefix;
 
-        static int last = '\n';  // Single log file
+        line += char(c);
 
-        if (last == '\n')
-            logBuf->sputn(prefix, 3);
+        if (c == '\n')
+            flush_line();
 
-        return last = logBuf->sputc(char(c));
+        return c;
+    }
+
+    // Blocks only in the unlikely case that the writer thread is a whole queue behind
+    void flush_line() {
+
+        if (line.empty())
+            return;
+
+        const int64_t time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+
+        while (!queue.try_push(line, time))
+            std::this_thread::yield();
+
+        line.clear();
     }
 };
 
 class Logger {
 
     Logger() :
-        in(std::cin.rdbuf(), file.rdbuf()),
-        out(std::cout.rdbuf(), file.rdbuf()) {}
+        in(std::cin.rdbuf(), queue, ">> "),
+        out(std::cout.rdbuf(), queue, "<< ") {}
     ~Logger() { start(""); }
 
+    std::string   fname;
     std::ofstream file;
+    size_t        fileSize = 0;
+    LogQueue      queue;
     Tie           in, out;
+    std::thread   writer;
 
-   public:
-    static void start(const std::string& fname) {
+    std::atomic_bool   stopWriter{false}, timestamps{false};
+    std::atomic_size_t maxFileSize{0};
 
+    static Logger& instance() {
         static Logger l;
+        return l;
+    }
+
+    // Keeps the last full log file with a ".1" suffix, when a size limit is set
+    void rotate() {
+        const std::string old = fname + ".1";
+
+        file.close();
+        std::remove(old.c_str());
+        std::rename(fname.c_str(), old.c_str());
+        file.open(fname, std::ifstream::out);
+        fileSize = 0;
+    }
+
+    void write(const std::string& line, int64_t time) {
+
+        if (timestamps)
+        {
+            const std::time_t sec = std::time_t(time / 1000);
+            char              stamp[32];
+
+            std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", std::localtime(&sec));
+            file << stamp << '.' << std::setfill('0') << std::setw(3) << time % 1000 << ' ';
+            fileSize += 24;
+        }
+
+        file << line;
+        fileSize += line.size();
+
+        if (maxFileSize && fileSize >= maxFileSize)
+            rotate();
+    }
+
+    void writer_loop() {
+
+        std::string line;
+        int64_t     time;
+        int         idle = 0;
+
+        while (true)
+        {
+            if (queue.try_pop(line, time))
+            {
+                write(line, time);
+                idle = 0;
+                continue;
+            }
+
+            // Every line pushed before the stop request has been written
+            if (stopWriter)
+                break;
+
+            // Flush once the queue runs dry, then back off to sleep
+            if (idle++ == 0)
+                file.flush();
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(idle, 10)));
+        }
+
+        file.flush();
+    }
+
+   public:
+    static void start(const std::string& name) {
+
+        Logger& l = instance();
 
         if (l.file.is_open())
         {
             std::cout.rdbuf(l.out.buf);
             std::cin.rdbuf(l.in.buf);
+
+            l.in.flush_line();
+            l.out.flush_line();
+
+            l.stopWriter = true;
+            l.writer.join();
+            l.stopWriter = false;
+
             l.file.close();
         }
 
-        if (!fname.empty())
+        if (!name.empty())
         {
-            l.file.open(fname, std::ifstream::out);
+            l.fname = name;
+            l.file.open(name, std::ifstream::out);
+            l.fileSize = 0;
 
             if (!l.file.is_open())
             {
-                std::cerr << "Unable to open debug log file " << fname << std::endl;
+                std::cerr << "Unable to open debug log file " << name << std::endl;
                 exit(EXIT_FAILURE);
             }
 
+            l.writer = std::thread(&Logger::writer_loop, &l);
+
             std::cin.rdbuf(&l.in);
             std::cout.rdbuf(&l.out);
         }
     }
+
+    static void configure(bool timestamps, size_t maxFileSize) {
+        instance().timestamps  = timestamps;
+        instance().maxFileSize = maxFileSize;
+    }
 };
 
 }  // namespace
@@ -415,9 +609,13 @@ std::ostream& operator<<(std::ostream& os, SyncCout sc) {
 void sync_cout_start() { std::cout << IO_LOCK; }
 void sync_cout_end() { std::cout << IO_UNLOCK; }
 
-// Trampoline helper to avoid moving Logger to misc.h
+// Trampoline helpers to avoid moving Logger to misc.h
 void start_logger(const std::string& fname) { Logger::start(fname); }
 
+void configure_logger(bool timestamps, size_t maxFileSize) {
+    Logger::configure(timestamps, maxFileSize);
+}
+
 
 #ifdef NO_PREFETCH
 
@@ -46,6 +46,9 @@ std::string compiler_info();
 void prefetch(const void* addr);
 
 void start_logger(const std::string& fname);
+// Prefix log lines with the time, and rotate the log file once it exceeds
+// maxFileSize bytes (no limit if 0)
+void configure_logger(bool timestamps, size_t maxFileSize);
 
 size_t str_to_size_t(const std::string& s);
 
@@ -19,6 +19,7 @@
 #include "movegen.h"
 
 #include <cassert>
+#include <cstdint>
 
 #include "bitboard.h"
 #include "position.h"
@@ -27,6 +28,20 @@ namespace Stockfish {
 
 namespace {
 
+// Appends the moves from 'from' to each square of 'b', in ascending order of the
+// target square. The two halves of the bitboard are scanned separately, which
+// avoids the 128-bit arithmetic of pop_lsb() for every move.
+inline ExtMove* splat_moves(ExtMove* moveList, Square from, Bitboard b) {
+
+    for (uint64_t w = uint64_t(b); w; w &= w - 1)
+        *moveList++ = Move(from, lsb(Bitboard(w)));
+
+    for (uint64_t w = uint64_t(b >> 64); w; w &= w - 1)
+        *moveList++ = Move(from, Square(int(lsb(Bitboard(w))) + 64));
+
+    return moveList;
+}
+
 template<Color Us, PieceType Pt, GenType Type>
 ExtMove* generate_moves(const Position& pos, ExtMove* moveList, Bitboard target) {
 
@@ -56,8 +71,7 @@ ExtMove* generate_moves(const Position& pos, ExtMove* moveList, Bitboard target)
                 b &= target;
         }
 
-        while (b)
-            *moveList++ = Move(from, pop_lsb(b));
+        moveList = splat_moves(moveList, from, b);
     }
 
     return moveList;
@@ -85,12 +99,7 @@ ExtMove* generate_all(const Position& pos, ExtMove* moveList) {
     moveList = generate_moves<Us, Type>(pos, moveList, target);
 
     if (Type != EVASIONS)
-    {
-        Bitboard b = attacks_bb<KING>(ksq) & target;
-
-        while (b)
-            *moveList++ = Move(ksq, pop_lsb(b));
-    }
+        moveList = splat_moves(moveList, ksq, attacks_bb<KING>(ksq) & target);
 
     return moveList;
 }
@@ -142,8 +151,7 @@ ExtMove* generate<EVASIONS>(const Position& pos, ExtMove* moveList) {
     // useless legality checks later on.
     if (pt == ROOK || pt == CANNON)
         b &= ~line_bb(checksq, ksq) | pos.pieces(~us);
-    while (b)
-        *moveList++ = Move(ksq, pop_lsb(b));
+    moveList = splat_moves(moveList, ksq, b);
 
     // Generate move away hurdle piece evasions for cannon
     if (pt == CANNON)
@@ -162,8 +170,7 @@ ExtMove* generate<EVASIONS>(const Position& pos, ExtMove* moveList) {
             else
                 b = attacks_bb(pt, hurdleSq, pos.pieces()) & ~line_bb(checksq, hurdleSq)
                   & ~pos.pieces(us);
-            while (b)
-                *moveList++ = Move(hurdleSq, pop_lsb(b));
+            moveList = splat_moves(moveList, hurdleSq, b);
         }
     }
 
@@ -20,6 +20,10 @@
 
 #include "half_ka_v2_hm.h"
 
+#include <algorithm>
+#include <numeric>
+
+#include "../../bitboard.h"
 #include "../../position.h"
 #include "../../types.h"
 #include "../nnue_accumulator.h"
@@ -39,17 +43,97 @@ IndexType HalfKAv2_hm::make_layer_stack_bucket(const Position& pos) {
                             [pos.count<KNIGHT>(~us) + pos.count<CANNON>(~us)];
 }
 
+// Get attack bucket of the position without the piece on s
+IndexType HalfKAv2_hm::make_attack_bucket(const Position& pos, Color c, Square s) {
+    const Bitboard others = ~square_bb(s);
+    return AttackBucket[popcount(pos.pieces(c, ROOK) & others)]
+                       [popcount(pos.pieces(c, KNIGHT) & others)]
+                       [popcount(pos.pieces(c, CANNON) & others)];
+}
+
+// Get layer stack bucket of the position without the piece on s
+IndexType HalfKAv2_hm::make_layer_stack_bucket(const Position& pos, Square s) {
+    Color          us     = pos.side_to_move();
+    const Bitboard others = ~square_bb(s);
+    return LayerStackBuckets[popcount(pos.pieces(us, ROOK) & others)]
+                            [popcount(pos.pieces(~us, ROOK) & others)]
+                            [popcount(pos.pieces(us, KNIGHT, CANNON) & others)]
+                            [popcount(pos.pieces(~us, KNIGHT, CANNON) & others)];
+}
+
 // Index of a feature for a given king position and another piece on some square
 template<Color Perspective>
-inline IndexType HalfKAv2_hm::make_index(Square s, Piece pc, int bucket, bool mirror) {
+inline IndexType HalfKAv2_hm::make_file_index(Square s, Piece pc, int bucket, bool mirror) {
     return IndexType(
       IndexMap[mirror][Perspective == BLACK][type_of(pc) == ADVISOR || type_of(pc) == BISHOP][s]
       + PieceSquareIndex[Perspective][pc] + PS_NB * bucket);
 }
 
 // Explicit template instantiations
-template IndexType HalfKAv2_hm::make_index<WHITE>(Square s, Piece pc, int bucket, bool mirror);
-template IndexType HalfKAv2_hm::make_index<BLACK>(Square s, Piece pc, int bucket, bool mirror);
+template IndexType HalfKAv2_hm::make_file_index<WHITE>(Square s, Piece pc, int bucket, bool mirror);
+template IndexType HalfKAv2_hm::make_file_index<BLACK>(Square s, Piece pc, int bucket, bool mirror);
+
+// Get a list of indices for active features, as in a full accumulator refresh
+template<Color Perspective>
+void HalfKAv2_hm::append_active_file_indices(const Position& pos, IndexList& active) {
+    const Square ksq           = pos.king_square(Perspective);
+    const Square oksq          = pos.king_square(~Perspective);
+    auto [king_bucket, mirror] = KingBuckets[ksq][oksq];
+    auto bucket                = king_bucket * 6 + make_attack_bucket(pos, Perspective);
+
+    for (Bitboard bb = pos.pieces(); bb;)
+    {
+        Square s = pop_lsb(bb);
+        active.push_back(make_file_index<Perspective>(s, pos.piece_on(s), bucket, mirror));
+    }
+}
+
+// Explicit template instantiations
+template void HalfKAv2_hm::append_active_file_indices<WHITE>(const Position& pos,
+                                                             IndexList&      active);
+template void HalfKAv2_hm::append_active_file_indices<BLACK>(const Position& pos,
+                                                             IndexList&      active);
+
+// Get a list of indices for the active features in a given attack bucket
+template<Color Perspective>
+void HalfKAv2_hm::append_active_indices(const Position& pos,
+                                        IndexType       attackBucket,
+                                        IndexList&      active) {
+    const Square ksq           = pos.king_square(Perspective);
+    const Square oksq          = pos.king_square(~Perspective);
+    auto [king_bucket, mirror] = KingBuckets[ksq][oksq];
+    auto bucket                = king_bucket * 6 + attackBucket;
+
+    for (Bitboard bb = pos.pieces(); bb;)
+    {
+        Square s = pop_lsb(bb);
+        active.push_back(make_index<Perspective>(s, pos.piece_on(s), bucket, mirror));
+    }
+}
+
+// Explicit template instantiations
+template void HalfKAv2_hm::append_active_indices<WHITE>(const Position& pos,
+                                                        IndexType       attackBucket,
+                                                        IndexList&      active);
+template void HalfKAv2_hm::append_active_indices<BLACK>(const Position& pos,
+                                                        IndexType       attackBucket,
+                                                        IndexList&      active);
+
+std::vector<HalfKAv2_hm::RowIndex>
+HalfKAv2_hm::order_by_frequency(const std::vector<std::uint64_t>& counts) {
+
+    std::vector<IndexType> features(Dimensions);
+    std::vector<RowIndex>  rows(Dimensions);
+
+    std::iota(features.begin(), features.end(), 0);
+    std::stable_sort(features.begin(), features.end(),
+                     [&](IndexType a, IndexType b) { return counts[a] > counts[b]; });
+
+    for (IndexType r = 0; r < Dimensions; ++r)
+        rows[features[r]] = RowIndex(r);
+
+    return rows;
+}
 
 // Get a list of indices for recently changed features
 template<Color Perspective>
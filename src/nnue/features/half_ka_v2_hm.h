@@ -24,6 +24,7 @@
 #include <array>
 #include <cstdint>
 #include <utility>
+#include <vector>
 
 #include "../../misc.h"
 #include "../../types.h"
@@ -201,9 +202,48 @@ class HalfKAv2_hm {
     // Get layer stack bucket
     static IndexType make_layer_stack_bucket(const Position& pos);
 
-    // Index of a feature for a given king position and another piece on some square
+    // The same buckets for the position without the piece on 's'
+    static IndexType make_attack_bucket(const Position& pos, Color c, Square s);
+    static IndexType make_layer_stack_bucket(const Position& pos, Square s);
+
+    // Index of a feature for a given king position and another piece on some
+    // square, in the order of the rows of the network file.
+    template<Color Perspective>
+    static IndexType make_file_index(Square s, Piece pc, int bucket, bool mirror);
+
+    // Row of the weights of a feature once the network is loaded, see RowOf
+    template<Color Perspective>
+    static IndexType make_index(Square s, Piece pc, int bucket, bool mirror) {
+        return RowOf[make_file_index<Perspective>(s, pc, bucket, mirror)];
+    }
+
+    // Appends the file indices of the features active in the position
+    template<Color Perspective>
+    static void append_active_file_indices(const Position& pos, IndexList& active);
+
+    // Appends the indices of the features active in the position, as if its
+    // attack bucket was 'attackBucket'
     template<Color Perspective>
-    static IndexType make_index(Square s, Piece pc, int bucket, bool mirror);
+    static void
+    append_active_indices(const Position& pos, IndexType attackBucket, IndexList& active);
+
+    // Row numbers are stored on 16 bits to keep the RowOf table small
+    using RowIndex = std::uint16_t;
+    static_assert(Dimensions <= 65536);
+
+    // Rows ordered by decreasing number of activations, so that the rows used
+    // most often share their pages and cache sets. Ties keep the file order.
+    static std::vector<RowIndex> order_by_frequency(const std::vector<std::uint64_t>& counts);
+
+    // The row of each feature, indexed by its file index. The loaded networks
+    // store their feature transformer rows in this order, the network files
+    // keep the order of make_file_index().
+    static inline std::array<RowIndex, Dimensions> RowOf = []() {
+        std::array<RowIndex, Dimensions> v{};
+        for (IndexType i = 0; i < Dimensions; ++i)
+            v[i] = RowIndex(i);
+        return v;
+    }();
 
     // Get a list of indices for recently changed features
     template<Color Perspective>
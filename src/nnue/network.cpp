@@ -15,6 +15,7 @@
 
 #include "network.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -25,6 +26,7 @@
 
 #include "../memory.h"
 #include "../misc.h"
+#include "../position.h"
 #include "../types.h"
 #include "nnue_architecture.h"
 #include "nnue_common.h"
@@ -105,6 +107,15 @@ void Network::load(const std::string& rootDirectory, std::string evalfilePath) {
 }
 
 
+// Whether the given network file, or the default one, is the loaded network
+bool Network::loaded(std::string evalfilePath) const {
+    if (evalfilePath.empty())
+        evalfilePath = evalFile.defaultName;
+
+    return evalFile.current == evalfilePath;
+}
+
+
 bool Network::save(const std::optional<std::string>& filename) const {
     std::string actualFilename;
     std::string msg;
@@ -192,9 +203,8 @@ void Network::verify(std::string                                  evalfilePath,
 
     if (f)
     {
-        size_t size = sizeof(*featureTransformer) + sizeof(NetworkArchitecture) * LayerStacks;
         f("info string NNUE evaluation using " + evalfilePath + " ("
-          + std::to_string(size / (1024 * 1024)) + "MiB, ("
+          + std::to_string(MemorySize / (1024 * 1024)) + "MiB, ("
           + std::to_string(featureTransformer->InputDimensions) + ", "
           + std::to_string(TransformedFeatureDimensions) + ", "
           + std::to_string(NetworkArchitecture::FC_0_OUTPUTS) + ", "
@@ -208,6 +218,12 @@ void Network::hint_common_access(const Position& pos, AccumulatorCaches::Cache*
 }
 
 
+void Network::reorder_features(const FeatureSet::RowIndex* from, const FeatureSet::RowIndex* to) {
+    if (featureTransformer)
+        featureTransformer->reorder_rows(from, to);
+}
+
+
 NnueEvalTrace Network::trace_evaluate(const Position& pos, AccumulatorCaches::Cache* cache) const {
     // We manually align the arrays on the stack because with gcc < 9.3
     // overaligning stack variables with alignas() doesn't work correctly.
@@ -241,6 +257,70 @@ NnueEvalTrace Network::trace_evaluate(const Position& pos, AccumulatorCaches::Ca
 }
 
 
+PieceValues Network::piece_values(const Position& pos) const {
+
+    struct alignas(CacheLineSize) TransformedFeatures {
+        TransformedFeatureType features[FeatureTransformer::BufferSize];
+    };
+
+    struct Removal {
+        Square       sq;
+        IndexType    bucket;
+        std::int32_t psqt;
+    };
+
+    std::vector<Removal> removals;
+    for (Bitboard b = pos.pieces() ^ pos.pieces(KING); b;)
+    {
+        Square s = pop_lsb(b);
+        removals.push_back({s, FeatureSet::make_layer_stack_bucket(pos, s), 0});
+    }
+
+    // All the positions are transformed first and then propagated grouped by
+    // layer stack, so that the weights of each stack are loaded only once.
+    std::stable_sort(removals.begin(), removals.end(),
+                     [](const Removal& a, const Removal& b) { return a.bucket < b.bucket; });
+
+    auto accumulators = make_unique_aligned<Accumulator[]>(2);
+    auto bases        = make_unique_aligned<Accumulator[]>(PIECE_TYPE_NB);
+    auto transformed  = make_unique_aligned<TransformedFeatures[]>(removals.size() + 1);
+
+    Accumulator& position = accumulators[0];
+    Accumulator& removed  = accumulators[1];
+
+    featureTransformer->refresh(pos, position);
+
+    for (size_t i = 0; i < removals.size(); ++i)
+    {
+        featureTransformer->remove_piece(pos, removals[i].sq, position, removed, bases.get());
+        removals[i].psqt = featureTransformer->transform(
+          removed, pos.side_to_move(), transformed[i].features, removals[i].bucket);
+    }
+
+    auto evaluate_side = [&](std::int32_t psqt, const TransformedFeatures& features, int bucket) {
+        const auto layers = network[bucket].propagate(features.features);
+        const auto v =
+          static_cast<Value>(psqt / OutputScale) + static_cast<Value>(layers / OutputScale);
+        return pos.side_to_move() == WHITE ? v : -v;
+    };
+
+    const int  bucket   = FeatureSet::make_layer_stack_bucket(pos);
+    auto&      features = transformed[removals.size()];
+    const auto psqt =
+      featureTransformer->transform(position, pos.side_to_move(), features.features, bucket);
+
+    PieceValues pv;
+    pv.eval = evaluate_side(psqt, features, bucket);
+    pv.values.fill(VALUE_NONE);
+
+    for (size_t i = 0; i < removals.size(); ++i)
+        pv.values[removals[i].sq] =
+          pv.eval - evaluate_side(removals[i].psqt, transformed[i], removals[i].bucket);
+
+    return pv;
+}
+
+
 void Network::load_user_net(const std::string& dir, const std::string& evalfilePath) {
     std::stringstream sstream     = read_compressed_nnue(dir + evalfilePath);
     auto              description = load(sstream);
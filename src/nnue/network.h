@@ -51,16 +51,31 @@ class Network {
     Network& operator=(const Network& other);
     Network& operator=(Network&& other) = default;
 
+    // Memory used by a loaded network, for each of its NUMA replicas
+    static constexpr size_t MemorySize =
+      sizeof(FeatureTransformer) + sizeof(NetworkArchitecture) * LayerStacks;
+
     void load(const std::string& rootDirectory, std::string evalfilePath);
+    bool loaded(std::string evalfilePath) const;
     bool save(const std::optional<std::string>& filename) const;
 
     NetworkOutput evaluate(const Position& pos, AccumulatorCaches::Cache* cache) const;
 
     void hint_common_access(const Position& pos, AccumulatorCaches::Cache* cache) const;
 
+    // Moves the feature transformer rows from the order 'from' to the order
+    // 'to', see FeatureSet::RowOf.
+    void reorder_features(const FeatureSet::RowIndex* from, const FeatureSet::RowIndex* to);
+
     void verify(std::string evalfilePath, const std::function<void(std::string_view)>&) const;
     NnueEvalTrace trace_evaluate(const Position& pos, AccumulatorCaches::Cache* cache) const;
 
+    // Evaluation of the position, with the value of each piece but the kings
+    // as the difference to the evaluation of the position without it. All the
+    // positions are derived from one accumulator computed from scratch, the
+    // accumulators of the position are neither used nor updated.
+    PieceValues piece_values(const Position& pos) const;
+
    private:
     void load_user_net(const std::string&, const std::string&);
 
@@ -27,6 +27,7 @@
 #include <cstring>
 #include <iosfwd>
 #include <utility>
+#include <vector>
 
 #include "../position.h"
 #include "../types.h"
@@ -313,6 +314,38 @@ class FeatureTransformer {
             biases[i] = read ? biases[i] * 2 : biases[i] / 2;
     }
 
+    // Moves the row of each feature i from from[i] to to[i], a null pointer
+    // standing for the order of the network file. Each permutation cycle is
+    // rotated through a single spare row.
+    void reorder_rows(const FeatureSet::RowIndex* from, const FeatureSet::RowIndex* to) {
+
+        std::vector<IndexType> dest(InputDimensions);
+        for (IndexType i = 0; i < InputDimensions; ++i)
+            dest[from ? from[i] : i] = to ? to[i] : i;
+
+        std::vector<WeightType>     row(HalfDimensions);
+        std::vector<PSQTWeightType> psqtRow(PSQTBuckets);
+        std::vector<bool>           done(InputDimensions);
+
+        auto swap_row = [&](IndexType r) {
+            std::swap_ranges(row.begin(), row.end(), &weights[r * HalfDimensions]);
+            std::swap_ranges(psqtRow.begin(), psqtRow.end(), &psqtWeights[r * PSQTBuckets]);
+        };
+
+        for (IndexType start = 0; start < InputDimensions; ++start)
+        {
+            if (done[start] || dest[start] == start)
+                continue;
+
+            swap_row(start);
+            for (IndexType r = dest[start]; !done[r]; r = dest[r])
+            {
+                swap_row(r);
+                done[r] = true;
+            }
+        }
+    }
+
     // Read network parameters
     bool read_parameters(std::istream& stream) {
 
@@ -322,12 +355,14 @@ class FeatureTransformer {
 
         permute_weights(inverse_order_packs);
         scale_weights(true);
+        reorder_rows(nullptr, FeatureSet::RowOf.data());
         return !stream.fail();
     }
 
     // Write network parameters
     bool write_parameters(std::ostream& stream) {
 
+        reorder_rows(FeatureSet::RowOf.data(), nullptr);
         permute_weights(order_packs);
         scale_weights(false);
 
@@ -337,6 +372,7 @@ class FeatureTransformer {
 
         permute_weights(inverse_order_packs);
         scale_weights(true);
+        reorder_rows(nullptr, FeatureSet::RowOf.data());
         return !stream.fail();
     }
 
@@ -348,14 +384,23 @@ class FeatureTransformer {
         update_accumulator<WHITE>(pos, cache);
         update_accumulator<BLACK>(pos, cache);
 
-        const Color perspectives[2]  = {pos.side_to_move(), ~pos.side_to_move()};
-        const auto& psqtAccumulation = pos.state()->accumulator.psqtAccumulation;
+        return transform(pos.state()->accumulator, pos.side_to_move(), output, bucket);
+    }
+
+    // Convert the input features of a computed accumulator
+    std::int32_t transform(const Accumulator& accumulator,
+                           Color              sideToMove,
+                           OutputType*        output,
+                           int                bucket) const {
+
+        const Color perspectives[2]  = {sideToMove, ~sideToMove};
+        const auto& psqtAccumulation = accumulator.psqtAccumulation;
 
         const auto psqt =
           (psqtAccumulation[perspectives[0]][bucket] - psqtAccumulation[perspectives[1]][bucket])
           / 2;
 
-        const auto& accumulation = pos.state()->accumulator.accumulation;
+        const auto& accumulation = accumulator.accumulation;
 
         for (IndexType p = 0; p < 2; ++p)
         {
@@ -473,7 +518,138 @@ class FeatureTransformer {
         hint_common_access_for_perspective<BLACK>(pos, cache);
     }
 
+    // Computes in 'to' the accumulators of the position from scratch, leaving
+    // the accumulators of its states untouched.
+    void refresh(const Position& pos, Accumulator& to) const {
+        refresh_in_bucket<WHITE>(pos, FeatureSet::make_attack_bucket(pos, WHITE), to);
+        refresh_in_bucket<BLACK>(pos, FeatureSet::make_attack_bucket(pos, BLACK), to);
+    }
+
+    // Computes in 'to' the accumulators of the position without the piece on
+    // 's' from 'from', the accumulators of the position. 'bases' holds one
+    // accumulator per piece type, uncomputed before the first call for the
+    // position and reused by the following ones.
+    void remove_piece(const Position&    pos,
+                      Square             s,
+                      const Accumulator& from,
+                      Accumulator&       to,
+                      Accumulator*       bases) const {
+        remove_piece<WHITE>(pos, s, from, to, bases);
+        remove_piece<BLACK>(pos, s, from, to, bases);
+    }
+
    private:
+    // Removing a piece is a single feature update, but removing a rook, a
+    // knight or a cannon changes the attack bucket of its own perspective,
+    // and so all of its features. The update then starts from the position
+    // summed in the new bucket, which only depends on the type of the piece.
+    template<Color Perspective>
+    void remove_piece(const Position&    pos,
+                      Square             s,
+                      const Accumulator& from,
+                      Accumulator&       to,
+                      Accumulator*       bases) const {
+        const Piece     pc           = pos.piece_on(s);
+        const IndexType attackBucket = FeatureSet::make_attack_bucket(pos, Perspective, s);
+        const auto [king_bucket, mirror] =
+          FeatureSet::KingBuckets[pos.king_square(Perspective)][pos.king_square(~Perspective)];
+
+        const Accumulator* base = &from;
+        assert(base->computed[Perspective]);
+
+        if (attackBucket != FeatureSet::make_attack_bucket(pos, Perspective))
+        {
+            base = &bases[type_of(pc)];
+
+            if (!base->computed[Perspective])
+                refresh_in_bucket<Perspective>(pos, attackBucket, bases[type_of(pc)]);
+        }
+
+        const IndexType index =
+          FeatureSet::make_index<Perspective>(s, pc, king_bucket * 6 + attackBucket, mirror);
+
+        for (IndexType i = 0; i < HalfDimensions; ++i)
+            to.accumulation[Perspective][i] =
+              base->accumulation[Perspective][i] - weights[index * HalfDimensions + i];
+
+        for (std::size_t i = 0; i < PSQTBuckets; ++i)
+            to.psqtAccumulation[Perspective][i] =
+              base->psqtAccumulation[Perspective][i] - psqtWeights[index * PSQTBuckets + i];
+
+        to.computed[Perspective] = true;
+    }
+
+    template<Color Perspective>
+    void refresh_in_bucket(const Position& pos, IndexType attackBucket, Accumulator& to) const {
+        FeatureSet::IndexList active;
+        FeatureSet::append_active_indices<Perspective>(pos, attackBucket, active);
+
+#ifdef VECTOR
+        vec_t      acc[NumRegs];
+        psqt_vec_t psqt[NumPsqtRegs];
+
+        for (IndexType j = 0; j < HalfDimensions / TileHeight; ++j)
+        {
+            auto biasesTile = reinterpret_cast<const vec_t*>(&biases[j * TileHeight]);
+
+            for (IndexType k = 0; k < NumRegs; ++k)
+                acc[k] = biasesTile[k];
+
+            for (const auto index : active)
+            {
+                const IndexType offset = HalfDimensions * index + j * TileHeight;
+                auto            column = reinterpret_cast<const vec_t*>(&weights[offset]);
+
+                for (unsigned k = 0; k < NumRegs; ++k)
+                    acc[k] = vec_add_16(acc[k], column[k]);
+            }
+
+            auto accTile = reinterpret_cast<vec_t*>(&to.accumulation[Perspective][j * TileHeight]);
+            for (IndexType k = 0; k < NumRegs; k++)
+                vec_store(&accTile[k], acc[k]);
+        }
+
+        for (IndexType j = 0; j < PSQTBuckets / PsqtTileHeight; ++j)
+        {
+            for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+                psqt[k] = vec_zero_psqt();
+
+            for (const auto index : active)
+            {
+                const IndexType offset = PSQTBuckets * index + j * PsqtTileHeight;
+                auto columnPsqt        = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offset]);
+
+                for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+                    psqt[k] = vec_add_psqt_32(psqt[k], columnPsqt[k]);
+            }
+
+            auto accTilePsqt = reinterpret_cast<psqt_vec_t*>(
+              &to.psqtAccumulation[Perspective][j * PsqtTileHeight]);
+            for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+                vec_store_psqt(&accTilePsqt[k], psqt[k]);
+        }
+
+#else
+
+        auto& acc  = to.accumulation[Perspective];
+        auto& psqt = to.psqtAccumulation[Perspective];
+
+        std::memcpy(acc, biases, sizeof(acc));
+        std::memset(psqt, 0, sizeof(psqt));
+
+        for (const auto index : active)
+        {
+            for (IndexType i = 0; i < HalfDimensions; ++i)
+                acc[i] += weights[index * HalfDimensions + i];
+
+            for (std::size_t i = 0; i < PSQTBuckets; ++i)
+                psqt[i] += psqtWeights[index * PSQTBuckets + i];
+        }
+#endif
+
+        to.computed[Perspective] = true;
+    }
+
     template<Color Perspective>
     StateInfo* try_find_computed_accumulator(const Position& pos) const {
         // Look for a usable accumulator of an earlier position. We keep track
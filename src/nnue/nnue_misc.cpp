@@ -26,7 +26,6 @@
 #include <iomanip>
 #include <sstream>
 #include <string_view>
-#include <tuple>
 
 #include "../position.h"
 #include "../types.h"
@@ -100,7 +99,8 @@ void format_cp_aligned_dot(Value v, std::stringstream& stream, const Position& p
 
 // Returns a string with the value of each piece on a board,
 // and a table for (PSQT, Layers) values bucket by bucket.
-std::string trace(Position& pos, const Eval::NNUE::Network& network, AccumulatorCaches& caches) {
+std::string
+trace(const Position& pos, const Eval::NNUE::Network& network, AccumulatorCaches& caches) {
 
     std::stringstream ss;
 
@@ -126,36 +126,13 @@ std::string trace(Position& pos, const Eval::NNUE::Network& network, Accumulator
 
     // We estimate the value of each piece by doing a differential evaluation from
     // the current base eval, simulating the removal of the piece from its square.
-    auto [psqt, positional] = network.evaluate(pos, &caches.cache);
-    Value base              = psqt + positional;
-    base                    = pos.side_to_move() == WHITE ? base : -base;
+    const PieceValues pv = network.piece_values(pos);
 
     for (File f = FILE_A; f <= FILE_I; ++f)
         for (Rank r = RANK_0; r <= RANK_9; ++r)
         {
             Square sq = make_square(f, r);
-            Piece  pc = pos.piece_on(sq);
-            Value  v  = VALUE_NONE;
-
-            if (pc != NO_PIECE && type_of(pc) != KING)
-            {
-                auto st = pos.state();
-
-                pos.remove_piece(sq);
-                st->accumulator.computed[WHITE] = false;
-                st->accumulator.computed[BLACK] = false;
-
-                std::tie(psqt, positional) = network.evaluate(pos, &caches.cache);
-                Value eval                 = psqt + positional;
-                eval                       = pos.side_to_move() == WHITE ? eval : -eval;
-                v                          = base - eval;
-
-                pos.put_piece(pc, sq);
-                st->accumulator.computed[WHITE] = false;
-                st->accumulator.computed[BLACK] = false;
-            }
-
-            writeSquare(f, r, pc, v);
+            writeSquare(f, r, pos.piece_on(sq), pv.values[sq]);
         }
 
     ss << " NNUE derived piece values:\n";
@@ -19,6 +19,7 @@
 #ifndef NNUE_MISC_H_INCLUDED
 #define NNUE_MISC_H_INCLUDED
 
+#include <array>
 #include <cstddef>
 #include <string>
 
@@ -50,10 +51,17 @@ struct NnueEvalTrace {
     std::size_t correctBucket;
 };
 
+// Values from the point of view of White, VALUE_NONE on the empty squares
+// and the squares of the kings.
+struct PieceValues {
+    Value                        eval;
+    std::array<Value, SQUARE_NB> values;
+};
+
 class Network;
 struct AccumulatorCaches;
 
-std::string trace(Position& pos, const Network& network, AccumulatorCaches& caches);
+std::string trace(const Position& pos, const Network& network, AccumulatorCaches& caches);
 void        hint_common_parent_position(const Position&    pos,
                                         const Network&     network,
                                         AccumulatorCaches& caches);
@@ -1214,6 +1214,12 @@ class LazyNumaReplicated: public NumaReplicatedBase {
         prepare_replicate_from(std::move(*source));
     }
 
+    // Creates the replicas of every NUMA node now instead of on first access
+    void replicate_all() const {
+        for (NumaIndex idx = 1; idx < instances.size(); ++idx)
+            ensure_present(idx);
+    }
+
    private:
     mutable std::vector<std::unique_ptr<T>> instances;
     mutable std::mutex                      mutex;
@@ -1263,6 +1269,36 @@ class LazyNumaReplicated: public NumaReplicatedBase {
     }
 };
 
+// Two LazyNumaReplicated objects, one of which is current. The other one can be
+// modified while readers keep using the current one, then published as the new
+// current one. Readers pick it up whenever they check the generation, so the
+// writer must make sure none of them still uses the standby object before
+// modifying it again.
+template<typename T>
+class DoubleBufferedNumaReplicated {
+   public:
+    DoubleBufferedNumaReplicated(NumaReplicationContext& ctx, T&& source, T&& standby) :
+        buffers{{ctx, std::move(source)}, {ctx, std::move(standby)}} {}
+
+    const LazyNumaReplicated<T>& current() const {
+        return buffers[active.load(std::memory_order_acquire)];
+    }
+    LazyNumaReplicated<T>& current() { return buffers[active.load(std::memory_order_acquire)]; }
+    LazyNumaReplicated<T>& standby() { return buffers[active.load(std::memory_order_acquire) ^ 1]; }
+
+    uint32_t generation() const { return gen.load(std::memory_order_acquire); }
+
+    void publish() {
+        active.fetch_xor(1, std::memory_order_release);
+        gen.fetch_add(1, std::memory_order_release);
+    }
+
+   private:
+    LazyNumaReplicated<T> buffers[2];
+    std::atomic<int>      active{0};
+    std::atomic<uint32_t> gen{0};
+};
+
 class NumaReplicationContext {
    public:
     NumaReplicationContext(NumaConfig&& cfg) :
@@ -0,0 +1,222 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "perfcounters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <cerrno>
+    #include <cstring>
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define USE_PERF_EVENTS
+#endif
+
+namespace Stockfish::PerfCounters {
+
+namespace {
+
+// Kept short to fit the label column of bench
+constexpr const char* EventNames[EVENT_NB] = {"Cycles",   "Instr.",    "L1D miss",
+                                              "LLC miss", "dTLB miss", "Br. miss"};
+
+// errno of the first failed perf_event_open call, 0 if none failed yet
+std::atomic<int> lastError{0};
+
+#ifdef USE_PERF_EVENTS
+
+constexpr uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr EventConfig Configs[EVENT_NB] = {
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                   PERF_COUNT_HW_CACHE_RESULT_MISS)},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+  {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                   PERF_COUNT_HW_CACHE_RESULT_MISS)},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+
+int open_event(const EventConfig& ec) {
+
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size        = sizeof(attr);
+    attr.type        = ec.type;
+    attr.config      = ec.config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // Counting user space only keeps working with the default perf_event_paranoid
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    // pid = 0 and cpu = -1: measure the calling thread on whichever CPU it runs
+    int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+
+    if (fd < 0)
+    {
+        int expected = 0;
+        lastError.compare_exchange_strong(expected, errno);
+    }
+
+    return fd;
+}
+
+#endif
+
+}  // namespace
+
+
+Sample& Sample::operator+=(const Sample& s) {
+
+    if (s.empty)
+        return *this;
+
+    for (int e = 0; e < EVENT_NB; ++e)
+    {
+        available[e] = (empty || available[e]) && s.available[e];
+        value[e] += s.value[e];
+    }
+
+    empty = false;
+    return *this;
+}
+
+
+void ThreadCounters::open() {
+
+    close();
+
+#ifdef USE_PERF_EVENTS
+    for (int e = 0; e < EVENT_NB; ++e)
+        fd[e] = open_event(Configs[e]);
+#endif
+}
+
+void ThreadCounters::close() {
+
+    for (int e = 0; e < EVENT_NB; ++e)
+    {
+#ifdef USE_PERF_EVENTS
+        if (fd[e] >= 0)
+            ::close(fd[e]);
+#endif
+        fd[e] = -1;
+    }
+}
+
+// Reads the current counter values. When the kernel had to multiplex the
+// hardware counters, the values are scaled up by the fraction of time the
+// event was actually counted.
+Sample ThreadCounters::read() const {
+
+    Sample s;
+    s.empty = false;
+
+#ifdef USE_PERF_EVENTS
+    for (int e = 0; e < EVENT_NB; ++e)
+    {
+        uint64_t data[3];  // value, time enabled, time running
+
+        if (fd[e] < 0 || ::read(fd[e], data, sizeof(data)) != sizeof(data))
+            continue;
+
+        s.available[e] = true;
+        s.value[e]     = data[2] == 0       ? 0
+                       : data[2] >= data[1] ? data[0]
+                                            : uint64_t(double(data[0]) * data[1] / data[2]);
+    }
+#endif
+
+    return s;
+}
+
+
+std::string unavailable_reason() {
+
+#ifdef USE_PERF_EVENTS
+    int err = lastError.load();
+
+    if (err == EACCES || err == EPERM)
+        return "permission denied, see /proc/sys/kernel/perf_event_paranoid";
+    if (err == ENOENT || err == EOPNOTSUPP)
+        return "events not supported by this CPU or hypervisor";
+    if (err == ENOSYS)
+        return "perf_event_open not supported by the kernel";
+
+    return err ? std::strerror(err) : "";
+#else
+    return "not supported on this platform";
+#endif
+}
+
+
+std::string report(const Sample& s, uint64_t nodes, int labelWidth) {
+
+    std::stringstream ss;
+    const double      n = double(std::max(nodes, uint64_t(1)));
+
+    auto label = [&](const std::string& str) {
+        ss << "\n" << std::left << std::setw(labelWidth) << str << ": ";
+    };
+
+    bool any = false;
+    for (int e = 0; e < EVENT_NB; ++e)
+        any |= s.available[e];
+
+    if (!any)
+    {
+        std::string reason = unavailable_reason();
+        label("Perf counters");
+        ss << "unavailable" << (reason.empty() ? "" : " (" + reason + ")");
+        return ss.str();
+    }
+
+    ss << std::fixed << std::setprecision(2);
+
+    if (s.available[CYCLES] && s.available[INSTRUCTIONS] && s.value[CYCLES])
+    {
+        label("IPC");
+        ss << double(s.value[INSTRUCTIONS]) / s.value[CYCLES];
+    }
+
+    for (int e = 0; e < EVENT_NB; ++e)
+    {
+        label(std::string(EventNames[e]) + "/node");
+
+        if (s.available[e])
+            ss << s.value[e] / n;
+        else
+            ss << "n/a";
+    }
+
+    return ss.str();
+}
+
+}  // namespace Stockfish::PerfCounters
@@ -0,0 +1,77 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PERFCOUNTERS_H_INCLUDED
+#define PERFCOUNTERS_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+namespace Stockfish::PerfCounters {
+
+// Hardware events sampled during bench and speedtest. They are read through
+// perf_event_open on Linux, elsewhere all of them are reported as unavailable.
+enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    DTLB_MISSES,
+    BRANCH_MISSES,
+    EVENT_NB
+};
+
+// Accumulated counter values of one or more threads. An event is available
+// only if it could be opened on every thread that contributed to the sample.
+struct Sample {
+    uint64_t value[EVENT_NB]     = {};
+    bool     available[EVENT_NB] = {};
+    bool     empty               = true;
+
+    Sample& operator+=(const Sample& s);
+};
+
+// A group of counters measuring the thread that called open(). The counters
+// can be read and closed from any thread, but must be opened from the one
+// that is measured, so the ThreadPool opens them through run_on_thread().
+class ThreadCounters {
+   public:
+    ThreadCounters() = default;
+    ~ThreadCounters() { close(); }
+
+    ThreadCounters(const ThreadCounters&)            = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+    void   open();
+    void   close();
+    Sample read() const;
+
+   private:
+    int fd[EVENT_NB] = {-1, -1, -1, -1, -1, -1};
+};
+
+// Returns an empty string if counters can be used, otherwise the reason why not
+std::string unavailable_reason();
+
+// Formats the sample as IPC and events per node, one event per line. Every line
+// starts with a label padded to 'labelWidth' characters.
+std::string report(const Sample& s, uint64_t nodes, int labelWidth);
+
+}  // namespace Stockfish::PerfCounters
+
+#endif  // #ifndef PERFCOUNTERS_H_INCLUDED
@@ -63,6 +63,16 @@ inline uint64_t perft(const std::string& fen, Depth depth) {
 
     return perft<true>(p, depth);
 }
+
+// Same as above, but without the divide output so that several positions
+// can be counted concurrently.
+inline uint64_t perft_count(const std::string& fen, Depth depth) {
+    StateListPtr states(new std::deque<StateInfo>(1));
+    Position     p;
+    p.set(fen, &states->back());
+
+    return depth <= 1 ? MoveList<LEGAL>(p).size() : perft<false>(p, depth);
+}
 }
 
 #endif  // PERFT_H_INCLUDED
@@ -170,23 +170,38 @@ Position& Position::set(const string& fenStr, StateInfo* si) {
 
     set_state();
 
+    keyHistory[historyIdx] = {st->key, Move::none(), NO_PIECE, bool(st->checkersBB)};
+
     assert(pos_is_ok());
 
     return *this;
 }
 
 
-// Sets king attacks to detect if a move gives check
+// Computes the parts of the check info that are not up to date yet. Usually
+// they are computed lazily by the accessors, but this has to be done while the
+// state is the current one, so it is forced for states that are read later on
+// or shared between threads, like the ones of the game history.
 void Position::set_check_info() const {
 
-    update_blockers<WHITE>();
-    update_blockers<BLACK>();
+    if (!(st->checkInfo & BLOCKERS_WHITE))
+        update_blockers<WHITE>();
 
-    Square ksq = king_square(~sideToMove);
+    if (!(st->checkInfo & BLOCKERS_BLACK))
+        update_blockers<BLACK>();
+
+    if (!(st->checkInfo & CHECK_SQUARES))
+        set_check_squares();
+
+    if (!(st->checkInfo & SLOW_CHECK))
+        set_slow_check();
+}
 
-    // We have to take special cares about the cannon and checks
-    st->needSlowCheck =
-      checkers() || (attacks_bb<ROOK>(king_square(sideToMove)) & pieces(~sideToMove, CANNON));
+
+// Sets king attacks to detect if a move gives check
+void Position::set_check_squares() const {
+
+    Square ksq = king_square(~sideToMove);
 
     st->checkSquares[PAWN]   = pawn_attacks_to_bb(sideToMove, ksq);
     st->checkSquares[KNIGHT] = attacks_bb<KNIGHT_TO>(ksq, pieces());
@@ -203,6 +218,18 @@ void Position::set_check_info() const {
         for (PieceType pt = ROOK; pt < KING; ++pt)
             st->checkSquares[pt] |= hollowCannonDiscover;
     }
+
+    st->checkInfo |= CHECK_SQUARES;
+}
+
+
+// We have to take special cares about the cannon and checks
+void Position::set_slow_check() const {
+
+    st->needSlowCheck =
+      checkers() || (attacks_bb<ROOK>(king_square(sideToMove)) & pieces(~sideToMove, CANNON));
+
+    st->checkInfo |= SLOW_CHECK;
 }
 
 
@@ -212,12 +239,14 @@ void Position::set_check_info() const {
 void Position::set_state() const {
 
     st->key           = 0;
+    st->materialKey   = 0;
     st->majorPieceKey = st->minorPieceKey = 0;
     st->nonPawnKey[WHITE] = st->nonPawnKey[BLACK] = 0;
     st->pawnKey                                   = Zobrist::noPawns;
     st->majorMaterial[WHITE] = st->majorMaterial[BLACK] = VALUE_ZERO;
     st->checkersBB = checkers_to(~sideToMove, king_square(sideToMove));
     st->move       = Move::none();
+    st->checkInfo  = 0;
 
     set_check_info();
 
@@ -227,6 +256,7 @@ void Position::set_state() const {
         Piece     pc = piece_on(s);
         PieceType pt = type_of(pc);
         st->key ^= Zobrist::psq[pc][s];
+        st->materialKey += Key(1) << (4 * pc);
 
         if (pt == PAWN)
             st->pawnKey ^= Zobrist::psq[pc][s];
@@ -303,6 +333,7 @@ void Position::update_blockers() const {
     Square ksq             = king_square(c);
     st->blockersForKing[c] = 0;
     st->pinners[~c]        = 0;
+    st->checkInfo |= (c == WHITE ? BLOCKERS_WHITE : BLOCKERS_BLACK);
 
     // Snipers are pieces that attack 's' when a piece and other pieces are removed
     Bitboard snipers = ((attacks_bb<ROOK>(ksq) & (pieces(ROOK) | pieces(CANNON) | pieces(KING)))
@@ -375,7 +406,7 @@ bool Position::legal(Move m) const {
     // 1. Not moving a pinned piece.
     // 2. Moving a pinned non-cannon piece and aligned with king.
     // 3. Moving a pinned cannon and aligned with king but it's not a capture move.
-    if (!st->needSlowCheck
+    if (!need_slow_check()
         && (!(blockers_for_king(us) & from)
             || (((type_of(piece_on(from)) != CANNON) || !capture(m))
                 && aligned(from, to, king_square(us)))))
@@ -545,8 +576,9 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
         if (attack_bucket_before != attack_bucket_after)
             dp.requires_refresh[them] = true;
 
-        // Update hash key
+        // Update hash keys
         k ^= Zobrist::psq[captured][capsq];
+        st->materialKey -= Key(1) << (4 * captured);
 
         // 重置60回合规则计数
         st->check10[WHITE] = st->check10[BLACK] = st->rule60 = 0;
@@ -591,11 +623,13 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
     st->checkersBB = givesCheck ? checkers_to(us, king_square(them)) : Bitboard(0);
     assert(givesCheck == bool(st->checkersBB));
 
+    keyHistory[++historyIdx & (KEY_HISTORY_SIZE - 1)] = {k, m, captured, givesCheck};
+
     // 翻转走子方
     sideToMove = ~sideToMove;
 
-    // Update king attacks used for fast check detection
-    set_check_info();
+    // King attacks used for fast check detection are computed on first use
+    st->checkInfo = 0;
 
     assert(pos_is_ok());
 }
@@ -627,6 +661,7 @@ void Position::undo_move(Move m) {
     // Finally point our state pointer back to the previous state
     st = st->previous;
     --gamePly;
+    --historyIdx;
 
     // Update the bloom filter
     --filter[st->key];
@@ -663,9 +698,12 @@ void Position::do_null_move(StateInfo& newSt, const TranspositionTable& tt) {
 
     st->pliesFromNull = 0;
 
+    keyHistory[++historyIdx & (KEY_HISTORY_SIZE - 1)] = {st->key, Move::none(), NO_PIECE, false};
+
     sideToMove = ~sideToMove;
 
-    set_check_info();
+    // The board is unchanged, so are the blockers if they were already known
+    st->checkInfo &= BLOCKERS_WHITE | BLOCKERS_BLACK;
 
     assert(pos_is_ok());
 }
@@ -678,6 +716,7 @@ void Position::undo_null_move() {
 
     st         = st->previous;
     sideToMove = ~sideToMove;
+    --historyIdx;
 
     // Update the bloom filter
     --filter[st->key];
@@ -971,37 +1010,50 @@ uint16_t Position::chased(Color c) {
 
 
 // Detects chases from state st - d to state st
-Value Position::detect_chases(int d, int ply) {
+Value Position::detect_chases(int d, int ply) const {
+
+    // Copy the current position to a rollback struct, so we don't need to do those moves again
+    Position rollback;
+    memcpy((void*) &rollback, (const void*) this, offsetof(Position, filter));
 
     // Grant each piece on board a unique id for each side
     int whiteId = 0;
     int blackId = 0;
     for (Square s = SQ_A0; s <= SQ_I9; ++s)
         if (board[s] != NO_PIECE)
-            idBoard[s] = color_of(board[s]) == WHITE ? whiteId++ : blackId++;
+            rollback.idBoard[s] = color_of(board[s]) == WHITE ? whiteId++ : blackId++;
 
     Color us = sideToMove, them = ~us;
 
-    // Rollback until we reached st - d
+    // Rollback until we reached st - d. The moves and checks are read from the
+    // key ring. The rollback position gets a scratch state of its own, where the
+    // blockers needed by chased() are recomputed after every step, so that the
+    // states of the game history, which other threads may share, stay untouched.
+    StateInfo scratch;
+    scratch.checkInfo = 0;
+    rollback.st       = &scratch;
+
     uint16_t chase[COLOR_NB] = {0xFFFF, 0xFFFF};
     for (int i = 0; i < d; ++i)
     {
-        if (st->checkersBB)
+        const KeyHistoryEntry& h = key_history(i);
+
+        if (h.inCheck)
             return VALUE_DRAW;
-        else if (!chase[~sideToMove])
+        else if (!chase[~rollback.sideToMove])
         {
-            if (!chase[sideToMove])
+            if (!chase[rollback.sideToMove])
                 break;
-            light_undo_move(st->move, st->capturedPiece);
-            st = st->previous;
+            rollback.light_undo_move(h.move, h.capturedPiece);
+            scratch.checkInfo = 0;
         }
         else
         {
-            uint16_t after = chased(~sideToMove);
-            light_undo_move(st->move, st->capturedPiece);
-            st = st->previous;
+            uint16_t after = rollback.chased(~rollback.sideToMove);
+            rollback.light_undo_move(h.move, h.capturedPiece);
+            scratch.checkInfo = 0;
             // Take the exact diff to detect the chase
-            chase[sideToMove] &= after & ~chased(sideToMove);
+            chase[rollback.sideToMove] &= after & ~rollback.chased(rollback.sideToMove);
         }
     }
 
@@ -1021,29 +1073,25 @@ bool Position::rule_judge(Value& result, int ply) {
 
     if (end >= 4 && filter[st->key] >= 1)
     {
-        int        cnt       = 0;
-        StateInfo* stp       = st->previous->previous;
-        bool       checkThem = st->checkersBB && stp->checkersBB;
-        bool       checkUs   = st->previous->checkersBB && stp->previous->checkersBB;
+        // Never look further back than the key ring reaches
+        end = std::min(end, KEY_HISTORY_SIZE - 2);
+
+        int  cnt       = 0;
+        bool checkThem = key_history(0).inCheck && key_history(2).inCheck;
+        bool checkUs   = key_history(1).inCheck && key_history(3).inCheck;
 
         for (int i = 4; i <= end; i += 2)
         {
-            stp = stp->previous->previous;
-            checkThem &= bool(stp->checkersBB);
+            const KeyHistoryEntry& hp = key_history(i);
+            checkThem &= hp.inCheck;
 
             // Return a score if a position repeats once earlier but strictly
             // after the root, or repeats twice before or at the root.
-            if (stp->key == st->key && (++cnt == 2 || ply > i))
+            if (hp.key == st->key && (++cnt == 2 || ply > i))
             {
                 if (!checkThem && !checkUs)
-                {
-                    // Copy the current position to a rollback struct, so we don't need to do those moves again
-                    Position rollback;
-                    memcpy((void*) &rollback, (const void*) this, offsetof(Position, filter));
-
                     // 检测“捉”
-                    result = rollback.detect_chases(i, ply);
-                }
+                    result = detect_chases(i, ply);
                 else
                     // 检测“将”
                     result = !checkUs ? mate_in(ply) : !checkThem ? mated_in(ply) : VALUE_DRAW;
@@ -1056,14 +1104,13 @@ bool Position::rule_judge(Value& result, int ply) {
                 if (filter[st->key] <= 1)
                 {
                     // Not exceeding rule 60 and have the same previous step
-                    if (st->rule60 < 120 && st->previous->key == stp->previous->key)
+                    if (st->rule60 < 120 && key_history(1).key == key_history(i + 1).key)
                     {
                         // Even if we entering this loop again, it will not lead to a 3 fold repetition
-                        StateInfo* next = stp;
-                        while ((next = next->next) != st->previous)
-                            if (filter[next->key] > 1)
-                                break;
-                        if (next == st->previous)
+                        int j = i - 1;
+                        while (j > 1 && filter[key_history(j).key] <= 1)
+                            --j;
+                        if (j == 1)
                             return true;
                     }
                     // We know there can't be another fold
@@ -1072,7 +1119,7 @@ bool Position::rule_judge(Value& result, int ply) {
             }
 
             if (i + 1 <= end)
-                checkUs &= bool(stp->previous->checkersBB);
+                checkUs &= key_history(i + 1).inCheck;
         }
     }
 
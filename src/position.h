@@ -37,6 +37,16 @@ namespace Stockfish {
 
 class TranspositionTable;
 
+// The check info of a StateInfo is computed lazily, on first access. These
+// flags tell which parts of it are up to date.
+enum CheckInfo : uint8_t {
+    BLOCKERS_WHITE = 1,  // blockersForKing[WHITE] and pinners[BLACK]
+    BLOCKERS_BLACK = 2,  // blockersForKing[BLACK] and pinners[WHITE]
+    CHECK_SQUARES  = 4,
+    SLOW_CHECK     = 8,
+    ALL_CHECK_INFO = 15
+};
+
 // StateInfo struct stores information needed to restore a Position object to
 // its previous state when we retract a move. Whenever a move is made on the
 // board (by calling Position::do_move), a StateInfo object must be passed.
@@ -44,6 +54,7 @@ class TranspositionTable;
 struct StateInfo {
 
     // Copied when making a move
+    Key     materialKey;
     Key     pawnKey;
     Key     majorPieceKey;
     Key     minorPieceKey;
@@ -62,6 +73,7 @@ struct StateInfo {
     Bitboard   pinners[COLOR_NB];
     Bitboard   checkSquares[PIECE_TYPE_NB];
     bool       needSlowCheck;
+    uint8_t    checkInfo;  // CheckInfo flags of the valid fields above
     Piece      capturedPiece;
     Move       move;
 
@@ -78,6 +90,18 @@ struct StateInfo {
 using StateListPtr = std::unique_ptr<std::deque<StateInfo>>;
 
 
+// Compact copy of the StateInfo fields scanned by the repetition and chase
+// detection. Position keeps the most recent ones in a ring, so rule_judge()
+// walks a few consecutive cache lines instead of chasing StateInfo pointers
+// spread over the search stack.
+struct KeyHistoryEntry {
+    Key   key;
+    Move  move;
+    Piece capturedPiece;
+    bool  inCheck;
+};
+
+
 // Position class stores information regarding the board representation as
 // pieces, side to move, hash keys, etc. Important methods are
 // do_move() and undo_move(), used by the search to update node info when
@@ -115,6 +139,8 @@ class Position {
     Bitboard blockers_for_king(Color c) const;
     Bitboard check_squares(PieceType pt) const;
     Bitboard pinners(Color c) const;
+    bool     need_slow_check() const;
+    void     set_check_info() const;
 
     // Attacks to/from a given square
     Bitboard attackers_to(Square s) const;
@@ -147,6 +173,7 @@ class Position {
     // Accessing hash keys
     Key key() const;
     Key key_after(Move m) const;
+    Key material_key() const;
     Key pawn_key() const;
     Key major_piece_key() const;
     Key minor_piece_key() const;
@@ -175,16 +202,18 @@ class Position {
    private:
     // Initialization helpers (used while setting up a position)
     void set_state() const;
-    void set_check_info() const;
+    void set_check_squares() const;
+    void set_slow_check() const;
 
     // Other helpers
     void                  move_piece(Square from, Square to);
     std::pair<Piece, int> light_do_move(Move m);
     void                  light_undo_move(Move m, Piece captured, int id = 0);
-    Value                 detect_chases(int d, int ply = 0);
+    Value                 detect_chases(int d, int ply = 0) const;
     bool                  chase_legal(Move m) const;
     template<bool AfterMove>
-    Key adjust_key60(Key k) const;
+    Key                    adjust_key60(Key k) const;
+    const KeyHistoryEntry& key_history(int pliesAgo) const;
 
     // Data members
     Piece      board[SQUARE_NB];
@@ -201,6 +230,11 @@ class Position {
 
     // Board for chasing detection
     int idBoard[SQUARE_NB];
+
+    // Ring of the most recent states, the current one is at historyIdx
+    static constexpr int KEY_HISTORY_SIZE = 1024;
+    int                  historyIdx;
+    KeyHistoryEntry      keyHistory[KEY_HISTORY_SIZE];
 };
 
 std::ostream& operator<<(std::ostream& os, const Position& pos);
@@ -263,11 +297,33 @@ inline Bitboard Position::attacks_by(Color c) const {
 
 inline Bitboard Position::checkers() const { return st->checkersBB; }
 
-inline Bitboard Position::blockers_for_king(Color c) const { return st->blockersForKing[c]; }
+inline Bitboard Position::blockers_for_king(Color c) const {
+    if (!(st->checkInfo & (c == WHITE ? BLOCKERS_WHITE : BLOCKERS_BLACK)))
+        c == WHITE ? update_blockers<WHITE>() : update_blockers<BLACK>();
+
+    return st->blockersForKing[c];
+}
 
-inline Bitboard Position::pinners(Color c) const { return st->pinners[c]; }
+inline Bitboard Position::pinners(Color c) const {
+    if (!(st->checkInfo & (c == WHITE ? BLOCKERS_BLACK : BLOCKERS_WHITE)))
+        c == WHITE ? update_blockers<BLACK>() : update_blockers<WHITE>();
+
+    return st->pinners[c];
+}
 
-inline Bitboard Position::check_squares(PieceType pt) const { return st->checkSquares[pt]; }
+inline Bitboard Position::check_squares(PieceType pt) const {
+    if (!(st->checkInfo & CHECK_SQUARES))
+        set_check_squares();
+
+    return st->checkSquares[pt];
+}
+
+inline bool Position::need_slow_check() const {
+    if (!(st->checkInfo & SLOW_CHECK))
+        set_slow_check();
+
+    return st->needSlowCheck;
+}
 
 inline Key Position::key() const { return adjust_key60<false>(st->key); }
 
@@ -277,6 +333,10 @@ inline Key Position::adjust_key60(Key k) const {
          ^ (filter[st->key] ? make_key(14) : 0);
 }
 
+// The material key packs the number of pieces of each kind, 4 bits per Piece.
+// Unlike a Zobrist hash it is exact, and the counts can be read back from it.
+inline Key Position::material_key() const { return st->materialKey; }
+
 inline Key Position::pawn_key() const { return st->pawnKey; }
 
 inline Key Position::major_piece_key() const { return st->majorPieceKey; }
@@ -339,6 +399,10 @@ inline void Position::do_move(Move m, StateInfo& newSt) { do_move(m, newSt, give
 
 inline StateInfo* Position::state() const { return st; }
 
+inline const KeyHistoryEntry& Position::key_history(int pliesAgo) const {
+    return keyHistory[(historyIdx - pliesAgo) & (KEY_HISTORY_SIZE - 1)];
+}
+
 inline Position& Position::set(const Position& pos, StateInfo* si) {
 
     set(pos.fen(), si);
@@ -346,6 +410,10 @@ inline Position& Position::set(const Position& pos, StateInfo* si) {
     // Special cares for bloom filter
     std::memcpy(&filter, &pos.filter, sizeof(BloomFilter));
 
+    // The root state keeps its game history, so does the key ring
+    std::memcpy(keyHistory, pos.keyHistory, sizeof(keyHistory));
+    historyIdx = pos.historyIdx;
+
     return *this;
 }
 
@@ -36,11 +36,15 @@ Stockfish 的分发是希望它有用，但 没有任何担保；甚至没有对
 #include <cstdint>
 #include <cstdlib>
 #include <initializer_list>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
 
 #include "evaluate.h"
 #include "history.h"
+#include "mcts.h"
 #include "misc.h"
 #include "movegen.h"
 #include "movepick.h"
@@ -61,6 +65,20 @@ using namespace Search;
 
 namespace {
 
+// YBWC split points are only created at this depth or higher, and each thread
+// owns at most this many of them at a time (nested inside each other).
+constexpr Depth SplitMinDepth           = 6;
+constexpr int   MaxSplitPointsPerThread = 8;
+
+// Returns the element of 'to' at the same offset as 'p' has in 'from', or 'p'
+// itself if it does not point into 'from'. Used to hand stack frames, which
+// point into the histories of their worker, over to another worker.
+template<typename T, typename Table>
+T* rebase(T* p, const Table& from, Table& to) {
+    const uintptr_t offset = uintptr_t(p) - uintptr_t(&from);
+    return offset < sizeof(Table) ? reinterpret_cast<T*>(uintptr_t(&to) + offset) : p;
+}
+
 // Futility margin
 // 无效剪枝边界
 Value futility_margin(Depth d, bool noTtCutNode, bool improving, bool oppWorsening) {
@@ -110,6 +128,85 @@ int stat_malus(Depth d) { return std::min(977 * d - 282, 1524); }
 // 在和棋评估中添加一个小的随机成分，以避免三重重复局面的盲点
 Value value_draw(size_t nodes) { return VALUE_DRAW - 1 + Value(nodes & 0x2); }
 
+// Version of the history file, to be increased whenever the set of tables or
+// their dimensions change.
+constexpr std::uint32_t HistoryFileVersion = 1;
+
+// A history table seen as the flat array of its 16 bit entries
+template<typename Table>
+auto entries_of(Table& table) {
+    static_assert(std::is_trivially_copyable_v<std::remove_const_t<Table>>
+                  && sizeof(Table) % sizeof(std::int16_t) == 0);
+
+    using Entry = std::conditional_t<std::is_const_v<Table>, const std::int16_t, std::int16_t>;
+    return std::pair(reinterpret_cast<Entry*>(&table), sizeof(Table) / sizeof(std::int16_t));
+}
+
+// Most entries of a history keep the value they were cleared to, so the tables
+// are run length encoded. Each block starts with a 32 bit header, either a run
+// of (header & RunFlag) copies of the value that follows, or 'header' literal
+// values. Everything is little endian.
+constexpr std::uint32_t RunFlag = 1u << 31;
+
+template<typename Table>
+void write_history(std::ostream& stream, const Table& table) {
+
+    auto [v, size] = entries_of(table);
+
+    Eval::NNUE::write_little_endian<std::uint32_t>(stream, std::uint32_t(size));
+
+    for (std::size_t i = 0; i < size;)
+    {
+        std::size_t run = 1;
+        while (i + run < size && v[i + run] == v[i])
+            ++run;
+
+        if (run >= 3)
+        {
+            Eval::NNUE::write_little_endian<std::uint32_t>(stream, RunFlag | std::uint32_t(run));
+            Eval::NNUE::write_little_endian<std::int16_t>(stream, v[i]);
+            i += run;
+            continue;
+        }
+
+        // Literals up to the start of the next run of at least three values
+        std::size_t end = i + run;
+        while (end < size && !(end + 2 < size && v[end] == v[end + 1] && v[end] == v[end + 2]))
+            ++end;
+
+        Eval::NNUE::write_little_endian<std::uint32_t>(stream, std::uint32_t(end - i));
+        Eval::NNUE::write_little_endian<std::int16_t>(stream, &v[i], end - i);
+        i = end;
+    }
+}
+
+template<typename Table>
+bool read_history(std::istream& stream, Table& table) {
+
+    auto [v, size] = entries_of(table);
+
+    if (Eval::NNUE::read_little_endian<std::uint32_t>(stream) != size)
+        return false;
+
+    for (std::size_t i = 0; i < size && stream;)
+    {
+        std::uint32_t header = Eval::NNUE::read_little_endian<std::uint32_t>(stream);
+        std::size_t   count  = header & ~RunFlag;
+
+        if (!count || count > size - i)
+            return false;
+
+        if (header & RunFlag)
+            std::fill_n(&v[i], count, Eval::NNUE::read_little_endian<std::int16_t>(stream));
+        else
+            Eval::NNUE::read_little_endian<std::int16_t>(stream, &v[i], count);
+
+        i += count;
+    }
+
+    return bool(stream);
+}
+
 Value value_to_tt(Value v, int ply);
 Value value_from_tt(Value v, int ply, int r60c);
 void  update_pv(Move* pv, Move move, const Move* childPv);
@@ -139,8 +236,10 @@ Search::Worker::Worker(SharedState&                    sharedState,
     options(sharedState.options),
     threads(sharedState.threads),
     tt(sharedState.tt),
-    network(sharedState.network),
-    refreshTable(network[token]) {
+    networks(sharedState.networks),
+    network(&networks.current()),
+    networkGeneration(networks.generation()),
+    refreshTable((*network)[token]) {
     clear();
 }
 
@@ -149,24 +248,118 @@ void Search::Worker::ensure_network_replicated() {
     // We do this because we want to avoid initialization during search.
     // 访问一次以强制进行延迟初始化。
     // 我们这样做是因为我们希望在搜索期间避免初始化。 
-    (void) (network[numaAccessToken]);
+    sync_network();
+    (void) ((*network)[numaAccessToken]);
+}
+
+void Search::Worker::sync_network() {
+    const uint32_t generation = networks.generation();
+
+    if (generation != networkGeneration.load(std::memory_order_relaxed))
+        use_network(networks.current(), generation);
+}
+
+// The accumulators computed with the previous network are invalidated: the
+// cache entries are reset and the root accumulator is marked as not computed.
+// The positions below the root get new states, and the earlier ones shared by
+// the threads are never computed.
+void Search::Worker::use_network(const LazyNumaReplicated<Eval::NNUE::Network>& net,
+                                 uint32_t                                       generation) {
+    if (network != &net)
+    {
+        network         = &net;
+        networkSyncTime = now();
+        refreshTable.clear((*network)[numaAccessToken]);
+        rootState.accumulator.computed[WHITE] = rootState.accumulator.computed[BLACK] = false;
+    }
+
+    networkGeneration.store(generation, std::memory_order_release);
+}
+
+bool Search::Worker::stopped() const {
+    return threads.stop.load(std::memory_order_relaxed) || standaloneStop;
+}
+
+Search::BatchResult Search::Worker::batch_result() const {
+
+    BatchResult result;
+
+    result.bestMove = rootMoves[0].pv[0];
+    result.score    = Score(rootMoves[0].uciScore, rootPos);
+    result.depth    = completedDepth;
+    result.nodes    = nodes;
+    result.timeMs   = now() - limits.startTime;
+
+    return result;
+}
+
+Search::BatchResult
+Search::Worker::search_alone(const Position&                                pos,
+                             const LimitsType&                              lim,
+                             const std::function<void(const BatchResult&)>& onIter) {
+
+    limits           = lim;
+    limits.startTime = now();
+    onIteration      = onIter;
+    nodes = publishedNodes = nmpMinPly = bestMoveChanges = 0;
+    rootDepth = completedDepth = 0;
+    resumed                    = false;
+    standalone                 = true;
+    standaloneStop             = false;
+
+    rootMoves.clear();
+    for (const auto& m : MoveList<LEGAL>(pos))
+        rootMoves.emplace_back(m);
+
+    // As in ThreadPool::start_thinking(), the root state keeps the link to the
+    // earlier states of the game, which the caller keeps alive.
+    rootPos.set(pos, &rootState);
+    rootState = *pos.state();
+
+    BatchResult result;
+
+    if (rootMoves.empty())
+        result.score = Score(mated_in(0), rootPos);
+    else
+    {
+        sync_network();
+        iterative_deepening();
+
+        result = batch_result();
+    }
+
+    standalone  = false;
+    onIteration = nullptr;
+    return result;
 }
 
 // 开始搜索的入口函数，属于 Search::Worker 类
 void Search::Worker::start_searching() {
 
+    sync_network();
+
     // 非主线程直接进入迭代加深搜索
     if (!is_mainthread())
     {
-        iterative_deepening();  // 非主线程直接执行迭代加深算法
-        return;                 // 非主线程后续无需处理其他逻辑
+        // In YBWC mode the helper threads only search at split points
+        if (threads.parallelSearch == ParallelSearch::YBWC)
+            help_split_points();
+        else if (threads.parallelSearch == ParallelSearch::BestFirst)
+            best_first_search();
+        else
+            iterative_deepening();  // 非主线程直接执行迭代加深算法
+
+        publish_nodes();
+        return;  // 非主线程后续无需处理其他逻辑
     }
 
     /*********************** 主线程专属逻辑 ***********************/
     // 初始化时间管理器（计算剩余时间、分配时间策略等）
     main_manager()->tm.init(limits, rootPos.side_to_move(), rootPos.game_ply(), options,
                             main_manager()->originalTimeAdjust);
-    tt.new_search();  // 重置置换表（Transposition Table），标记新搜索开始
+    // 恢复挂起的搜索时保留置换表世代，避免其条目被当作旧条目替换
+    if (!resumed)
+        tt.new_search();  // 重置置换表（Transposition Table），标记新搜索开始
 
     // 处理无有效着法的特殊情况
     if (rootMoves.empty())
@@ -177,10 +370,28 @@ void Search::Worker::start_searching() {
     }
     else
     {
+        // 选择并行搜索算法，最优优先搜索每次从一棵新树开始
+        threads.parallelSearch =
+          options["Parallel Search"] == "BestFirst"                    ? ParallelSearch::BestFirst
+          : options["Parallel Search"] == "YBWC" && threads.size() > 1 ? ParallelSearch::YBWC
+                                                                       : ParallelSearch::LazySMP;
+
+        if (threads.parallelSearch == ParallelSearch::BestFirst)
+        {
+            threads.bestFirstTree.resize(size_t(options["BestFirst Memory"]));
+            threads.bestFirstTree.clear();
+        }
+
         threads.start_searching();  // 启动所有非主线程开始搜索
-        iterative_deepening();      // 主线程自身也开始迭代深化搜索
+
+        if (threads.parallelSearch == ParallelSearch::BestFirst)
+            best_first_search();
+        else
+            iterative_deepening();  // 主线程自身也开始迭代深化搜索
     }
 
+    publish_nodes();
+
     /*********************** 搜索结束后的同步处理 ***********************/
     /* 当达到最大深度时，可能未触发 threads.stop。但在ponder或无限搜索模式下，
        UCI协议要求必须在收到"stop"或"ponderhit"后才能输出最佳着法 */
@@ -192,6 +403,14 @@ void Search::Worker::start_searching() {
 
     threads.wait_for_search_finished();  // 阻塞等待所有线程完全停止
 
+    // A suspended search keeps its state for ThreadPool::resume() and reports
+    // its best move only once it has been resumed and finished.
+    if (threads.suspendRequested && rootMoves[0].pv[0] != Move::none())
+    {
+        threads.searchSuspended = true;
+        return;
+    }
+
     // 处理"nodes as time"模式：将实际时间转换为虚拟节点数进行管理
     if (limits.npmsec)
         main_manager()->tm.advance_nodes_time(threads.nodes_searched()
@@ -201,7 +420,10 @@ void Search::Worker::start_searching() {
     Worker* bestThread = this;  // 默认当前线程为最佳
 
     // 当启用单线MultiPV且非固定深度搜索时，从所有线程中选取最佳
-    if (int(options["MultiPV"]) == 1 && !limits.depth && rootMoves[0].pv[0] != Move::none())
+    // 在YBWC和最优优先模式下只有主线程拥有完整的根着法结果
+    if (int(options["MultiPV"]) == 1 && !limits.depth
+        && threads.parallelSearch == ParallelSearch::LazySMP
+        && rootMoves[0].pv[0] != Move::none())
         bestThread = threads.get_best_thread()->worker.get();
 
     // 记录最佳分数用于后续搜索参考
@@ -288,13 +510,17 @@ void Search::Worker::iterative_deepening() {
 
     int searchAgainCounter = 0;
 
-    lowPlyHistory.fill(106);
+    if (!resumed)
+        lowPlyHistory.fill(106);
 
     // Iterative deepening loop until requested to stop or the target depth is reached
     // 迭代加深循环，直到收到停止请求或达到目标深度
-    while (++rootDepth < MAX_PLY && !threads.stop
-           && !(limits.depth && mainThread && rootDepth > limits.depth))
+    while (++rootDepth < MAX_PLY && !stopped()
+           && !(limits.depth && (mainThread || standalone) && rootDepth > limits.depth))
     {
+        // A network loaded during the search is picked up between iterations
+        sync_network();
+
         // Age out PV variability metric
         if (mainThread)
             totBestMoveChanges /= 2;
@@ -351,7 +577,7 @@ void Search::Worker::iterative_deepening() {
                 // safe because RootMoves is still valid, although it refers to
                 // the previous iteration.
                 // 检查停止信号
-                if (threads.stop)
+                if (stopped())
                     break;
 
                 // When failing high/low give some update before a re-search. To avoid
@@ -389,7 +615,7 @@ void Search::Worker::iterative_deepening() {
             std::stable_sort(rootMoves.begin() + pvFirst, rootMoves.begin() + pvIdx + 1);
 
             if (mainThread
-                && (threads.stop || pvIdx + 1 == multiPV || nodes > 10000000)
+                && (stopped() || pvIdx + 1 == multiPV || nodes > 10000000)
                 // A thread that aborted search can have mated-in PV and
                 // score that cannot be trusted, i.e. it can be delayed or refuted
                 // if we would have had time to fully search other root-moves. Thus
@@ -398,11 +624,11 @@ void Search::Worker::iterative_deepening() {
                 && !(threads.abortedSearch && is_loss(rootMoves[0].uciScore)))
                 main_manager()->pv(*this, threads, tt, rootDepth);
 
-            if (threads.stop)
+            if (stopped())
                 break;
         }
 
-        if (!threads.stop)
+        if (!stopped())
             completedDepth = rootDepth;
 
         // We make sure not to pick an unproven mated-in score,
@@ -423,6 +649,9 @@ void Search::Worker::iterative_deepening() {
             lastBestMoveDepth = rootDepth;
         }
 
+        if (onIteration && !stopped())
+            onIteration(batch_result());
+
         if (!mainThread)
             continue;
 
@@ -492,6 +721,103 @@ void Search::Worker::iterative_deepening() {
     mainThread->previousTimeReduction = timeReduction;
 }
 
+void Search::Worker::save(WorkerSnapshot& s) const {
+    s.mainHistory                   = mainHistory;
+    s.lowPlyHistory                 = lowPlyHistory;
+    s.captureHistory                = captureHistory;
+    s.pawnHistory                   = pawnHistory;
+    s.pawnCorrectionHistory         = pawnCorrectionHistory;
+    s.majorPieceCorrectionHistory   = majorPieceCorrectionHistory;
+    s.minorPieceCorrectionHistory   = minorPieceCorrectionHistory;
+    s.nonPawnCorrectionHistory[0]   = nonPawnCorrectionHistory[0];
+    s.nonPawnCorrectionHistory[1]   = nonPawnCorrectionHistory[1];
+    s.continuationCorrectionHistory = continuationCorrectionHistory;
+
+    for (bool inCheck : {false, true})
+        for (StatsType c : {NoCaptures, Captures})
+            s.continuationHistory[inCheck][c] = continuationHistory[inCheck][c];
+
+    s.rootMoves      = rootMoves;
+    s.completedDepth = completedDepth;
+    s.nodes          = nodes;
+}
+
+// The interrupted iteration is searched again from scratch, so the next
+// iteration starts right after the last completed depth.
+void Search::Worker::restore(const WorkerSnapshot& s) {
+    mainHistory                   = s.mainHistory;
+    lowPlyHistory                 = s.lowPlyHistory;
+    captureHistory                = s.captureHistory;
+    pawnHistory                   = s.pawnHistory;
+    pawnCorrectionHistory         = s.pawnCorrectionHistory;
+    majorPieceCorrectionHistory   = s.majorPieceCorrectionHistory;
+    minorPieceCorrectionHistory   = s.minorPieceCorrectionHistory;
+    nonPawnCorrectionHistory[0]   = s.nonPawnCorrectionHistory[0];
+    nonPawnCorrectionHistory[1]   = s.nonPawnCorrectionHistory[1];
+    continuationCorrectionHistory = s.continuationCorrectionHistory;
+
+    for (bool inCheck : {false, true})
+        for (StatsType c : {NoCaptures, Captures})
+            continuationHistory[inCheck][c] = s.continuationHistory[inCheck][c];
+
+    rootMoves       = s.rootMoves;
+    rootDepth       = s.completedDepth;
+    completedDepth  = s.completedDepth;
+    nodes           = s.nodes;
+    publishedNodes  = 0;
+    bestMoveChanges = 0;
+    nmpMinPly       = 0;
+    resumed         = true;
+}
+
+void Search::Worker::publish_nodes() {
+    nodeCounter->fetch_add(nodes - publishedNodes, std::memory_order_relaxed);
+    publishedNodes = nodes;
+}
+
+// The histories that are kept from one search to the next. The low ply history
+// is reset by every search and is not saved.
+void Search::Worker::save_histories(std::ostream& stream) const {
+
+    Eval::NNUE::write_little_endian<std::uint32_t>(stream, HistoryFileVersion);
+
+    write_history(stream, mainHistory);
+    write_history(stream, captureHistory);
+    write_history(stream, pawnHistory);
+    write_history(stream, pawnCorrectionHistory);
+    write_history(stream, majorPieceCorrectionHistory);
+    write_history(stream, minorPieceCorrectionHistory);
+    write_history(stream, nonPawnCorrectionHistory[WHITE]);
+    write_history(stream, nonPawnCorrectionHistory[BLACK]);
+    write_history(stream, continuationCorrectionHistory);
+
+    for (bool inCheck : {false, true})
+        for (StatsType c : {NoCaptures, Captures})
+            write_history(stream, continuationHistory[inCheck][c]);
+}
+
+// On failure the histories are cleared, a partly read file is never used
+bool Search::Worker::load_histories(std::istream& stream) {
+
+    bool ok = Eval::NNUE::read_little_endian<std::uint32_t>(stream) == HistoryFileVersion
+           && read_history(stream, mainHistory) && read_history(stream, captureHistory)
+           && read_history(stream, pawnHistory) && read_history(stream, pawnCorrectionHistory)
+           && read_history(stream, majorPieceCorrectionHistory)
+           && read_history(stream, minorPieceCorrectionHistory)
+           && read_history(stream, nonPawnCorrectionHistory[WHITE])
+           && read_history(stream, nonPawnCorrectionHistory[BLACK])
+           && read_history(stream, continuationCorrectionHistory);
+
+    for (bool inCheck : {false, true})
+        for (StatsType c : {NoCaptures, Captures})
+            ok = ok && read_history(stream, continuationHistory[inCheck][c]);
+
+    if (!ok)
+        clear();
+
+    return ok;
+}
+
 // Reset histories, usually before a new game
 void Search::Worker::clear() {
     mainHistory.fill(61);
@@ -517,7 +843,8 @@ void Search::Worker::clear() {
     for (size_t i = 1; i < reductions.size(); ++i)
         reductions[i] = int(14.60 * std::log(i));
 
-    refreshTable.clear(network[numaAccessToken]);
+    sync_network();
+    refreshTable.clear((*network)[numaAccessToken]);
 }
 
 
@@ -577,6 +904,10 @@ Value Search::Worker::search(
     // 检查剩余可用时间
     if (is_mainthread())
         main_manager()->check_time(*thisThread);
+    else if (standalone)
+        standaloneStop |= (limits.nodes && nodes >= limits.nodes)
+                        || (limits.movetime && !(nodes & 1023)
+                            && now() - limits.startTime >= limits.movetime);
 
     // Used to send selDepth info to GUI (selDepth counts from 1, ply from 0)
     // 用于将selDepth（选择性搜索深度）信息发送到GUI（selDepth计数从1开始，层数从0开始）
@@ -611,7 +942,7 @@ Value Search::Worker::search(
                 beta = std::min(beta, VALUE_DRAW + 1);
         }
 
-        if (threads.stop.load(std::memory_order_relaxed) || ss->ply >= MAX_PLY)
+        if (stopped() || ss->ply >= MAX_PLY)
             return (ss->ply >= MAX_PLY && !ss->inCheck) ? evaluate(pos)
                                                         : value_draw(thisThread->nodes);
 
@@ -712,7 +1043,7 @@ Value Search::Worker::search(
         // 优化原理：通过 NUMA 亲和性预加载神经网络权重，减少缓存失效
         Eval::NNUE::hint_common_parent_position(
             pos,                   // 当前棋盘位置
-            network[numaAccessToken], // NUMA 节点对应的神经网络（优化跨节点访问延迟）
+            (*network)[numaAccessToken], // NUMA 节点对应的神经网络（优化跨节点访问延迟）
             refreshTable           // 神经网络权重刷新表
         );
 
@@ -728,7 +1059,7 @@ Value Search::Worker::search(
         if (!is_valid(unadjustedStaticEval))
             unadjustedStaticEval = evaluate(pos);
         else if (PvNode)
-            Eval::NNUE::hint_common_parent_position(pos, network[numaAccessToken], refreshTable);
+            Eval::NNUE::hint_common_parent_position(pos, (*network)[numaAccessToken], refreshTable);
 
         ss->staticEval = eval = to_corrected_static_eval(unadjustedStaticEval, correctionValue);
 
@@ -909,7 +1240,7 @@ Value Search::Worker::search(
             ss->continuationCorrectionHistory =
               &this->continuationCorrectionHistory[pos.moved_piece(move)][move.to_sq()];
 
-            thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+            thisThread->count_node();
             pos.do_move(move, st);
 
             // Perform a preliminary qsearch to verify that the move holds
@@ -936,7 +1267,7 @@ Value Search::Worker::search(
             }
         }
 
-        Eval::NNUE::hint_common_parent_position(pos, network[numaAccessToken], refreshTable);
+        Eval::NNUE::hint_common_parent_position(pos, (*network)[numaAccessToken], refreshTable);
     }
 
 moves_loop:  // 将军时搜索从这里开始
@@ -1204,7 +1535,7 @@ moves_loop:  // 将军时搜索从这里开始
 
         // Step 15. Make the move
         // 步骤15. 执行这步棋 
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        thisThread->count_node();
         pos.do_move(move, st, givesCheck);
 
         // These reduction adjustments have proven non-linear scaling.
@@ -1353,7 +1684,7 @@ moves_loop:  // 将军时搜索从这里开始
         // 步骤19. 检查是否有新的最佳走法
         // 已完成该走法的搜索。如果出现了停止情况，搜索的返回值不可信，我们会立即返回，
         // 而不更新最佳走法、主变以及置换表。 
-        if (threads.stop.load(std::memory_order_relaxed))
+        if (stopped() || (activeSplitPoint && cutoff_occurred()))
             return VALUE_ZERO;
 
         if (rootNode)
@@ -1460,6 +1791,25 @@ moves_loop:  // 将军时搜索从这里开始
             else
                 quietsSearched.push_back(move);
         }
+
+        // Young Brothers Wait: once the first move has been searched, share the
+        // remaining ones with the idle threads and continue at the split point.
+        if (!rootNode && depth >= SplitMinDepth && !excludedMove
+            && threads.parallelSearch == ParallelSearch::YBWC
+            && splitPointsSize < MaxSplitPointsPerThread
+            && threads.idleHelpers.load(std::memory_order_relaxed) > 0)
+        {
+            constexpr NodeType nt = PvNode ? PV : NonPV;
+            split<nt>(pos, ss, alpha, beta, bestValue, bestMove, depth, moveCount, mp, cutNode,
+                      improving);
+
+            if (threads.stop.load(std::memory_order_relaxed)
+                || (activeSplitPoint && cutoff_occurred()))
+                return VALUE_ZERO;
+
+            ss->moveCount = moveCount;
+            break;
+        }
     }
 
     // Step 20. Check for mate
@@ -1805,7 +2155,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
           &thisThread->continuationCorrectionHistory[pos.moved_piece(move)][move.to_sq()];
 
         // Step 7. Make and search the move
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        thisThread->count_node();
         pos.do_move(move, st, givesCheck);
         value = -qsearch<nodeType>(pos, ss + 1, -beta, -alpha);
         pos.undo_move(move);
@@ -1855,6 +2205,448 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     return bestValue;
 }
 
+// Shares the remaining moves of the node with the idle threads. The owner
+// searches them too, from a copy of the position, so that 'pos' and 'mp' stay
+// at the split node for the helpers. Returns once every move has been searched
+// or a beta cutoff occurred, and every helper has left the split point.
+template<NodeType nodeType>
+void Search::Worker::split(Position&   pos,
+                           Stack*      ss,
+                           Value&      alpha,
+                           Value       beta,
+                           Value&      bestValue,
+                           Move&       bestMove,
+                           Depth       depth,
+                           int&        moveCount,
+                           MovePicker& mp,
+                           bool        cutNode,
+                           bool        improving) {
+
+    SplitPoint sp;
+    sp.pos            = &pos;
+    sp.ss             = ss;
+    sp.owner          = this;
+    sp.parent         = activeSplitPoint;
+    sp.movePicker     = &mp;
+    sp.depth          = depth;
+    sp.beta           = beta;
+    sp.pvNode         = nodeType == PV;
+    sp.cutNode        = cutNode;
+    sp.improving      = improving;
+    sp.alpha          = alpha;
+    sp.bestValue      = bestValue;
+    sp.bestMove       = bestMove;
+    sp.moveCount      = moveCount;
+    sp.allMovesPicked = false;
+    sp.helpers        = 0;
+    sp.cutoff         = false;
+
+    // The threads copy the accumulator of the split node, so that none of them
+    // ever updates the accumulators of the states it shares with the others.
+    Eval::NNUE::hint_common_parent_position(pos, (*network)[numaAccessToken], refreshTable);
+
+    ++splitPointsSize;
+    threads.push_split_point(&sp);
+
+    search_split_point<nodeType>(sp);
+
+    // No helper can join anymore, wait for the ones still searching. The main
+    // thread keeps an eye on the clock meanwhile.
+    threads.remove_split_point(&sp);
+
+    while (sp.helpers.load(std::memory_order_acquire))
+    {
+        if (is_mainthread())
+            main_manager()->check_time(*this);
+
+        std::this_thread::yield();
+    }
+
+    --splitPointsSize;
+
+    alpha     = sp.alpha;
+    bestValue = sp.bestValue;
+    bestMove  = sp.bestMove;
+    moveCount = sp.moveCount;
+}
+
+
+// Searches moves of the split point until none is left or a cutoff occurred.
+// Compared to the move loop of search() the pruning is limited to late move
+// pruning and the reductions to a simplified LMR.
+template<NodeType nodeType>
+void Search::Worker::search_split_point(SplitPoint& sp) {
+
+    constexpr bool PvNode = nodeType == PV;
+
+    const Worker& owner = *sp.owner;
+
+    Position  pos;
+    StateInfo splitSt, st;
+    Move      pv[MAX_PLY + 1];
+    Stack     stack[MAX_PLY + 10] = {};
+    Stack*    ss                  = stack + 7;
+
+    // A helper evaluates with the network of the owner, whose accumulators it
+    // copies. The owner does not switch network while its split point is alive.
+    if (&owner != this)
+        use_network(*owner.network, owner.networkGeneration.load(std::memory_order_relaxed));
+
+    if (&owner != this)
+    {
+        rootDepth       = owner.rootDepth;
+        completedDepth  = owner.completedDepth;
+        rootDelta       = owner.rootDelta;
+        nmpMinPly       = owner.nmpMinPly;
+        optimism[WHITE] = owner.optimism[WHITE];
+        optimism[BLACK] = owner.optimism[BLACK];
+    }
+
+    // Copy the split position. The copy of its state keeps the previous states
+    // for the repetition detection, and its accumulator is already computed.
+    {
+        std::lock_guard<std::mutex> lock(sp.mutex);
+
+        pos.set(*sp.pos, &splitSt);
+        splitSt = *sp.pos->state();
+    }
+
+    // Copy the frames from (ss - 7) to (ss + 2), see iterative_deepening()
+    for (int i = -7; i <= 2; ++i)
+    {
+        ss[i]                     = sp.ss[i];
+        ss[i].continuationHistory = rebase(ss[i].continuationHistory, owner.continuationHistory,
+                                           continuationHistory);
+        ss[i].continuationCorrectionHistory =
+          rebase(ss[i].continuationCorrectionHistory, owner.continuationCorrectionHistory,
+                 continuationCorrectionHistory);
+    }
+
+    for (int i = 3; ss->ply + i <= MAX_PLY + 2; ++i)
+        (ss + i)->ply = ss->ply + i;
+
+    const Color           us         = pos.side_to_move();
+    const PieceToHistory* contHist[] = {(ss - 1)->continuationHistory,
+                                        (ss - 2)->continuationHistory};
+
+    SplitPoint* parentSplitPoint = activeSplitPoint;
+    activeSplitPoint             = &sp;
+
+    while (true)
+    {
+        Move  move;
+        Value alpha, value;
+        int   moveCount;
+
+        {
+            std::lock_guard<std::mutex> lock(sp.mutex);
+
+            if (sp.allMovesPicked || sp.cutoff.load(std::memory_order_relaxed))
+                break;
+
+            if (sp.pos->major_material(us) && !is_loss(sp.bestValue)
+                && sp.moveCount >= futility_move_count(sp.improving, sp.depth))
+                sp.movePicker->skip_quiet_moves();
+
+            move = sp.movePicker->next_move();
+
+            if (move == Move::none())
+            {
+                sp.allMovesPicked = true;
+                break;
+            }
+
+            if (move == ss->excludedMove || !sp.pos->legal(move))
+                continue;
+
+            moveCount = ss->moveCount = ++sp.moveCount;
+            alpha                     = sp.alpha;
+        }
+
+        if (PvNode)
+            (ss + 1)->pv = nullptr;
+
+        bool  capture    = pos.capture(move);
+        Piece movedPiece = pos.moved_piece(move);
+        bool  givesCheck = pos.gives_check(move);
+        Depth newDepth   = sp.depth - 1;
+        Depth r          = reduction(sp.improving, sp.depth, moveCount, sp.beta - alpha);
+
+        prefetch(tt.first_entry(pos.key_after(move)));
+
+        ss->currentMove = move;
+        ss->continuationHistory =
+          &continuationHistory[ss->inCheck][capture][movedPiece][move.to_sq()];
+        ss->continuationCorrectionHistory =
+          &continuationCorrectionHistory[movedPiece][move.to_sq()];
+
+        count_node();
+        pos.do_move(move, st, givesCheck);
+
+        if (capture)
+            ss->statScore =
+              7 * int(PieceValue[pos.captured_piece()])
+              + captureHistory[movedPiece][move.to_sq()][type_of(pos.captured_piece())] - 5000;
+        else
+            ss->statScore = 2 * mainHistory[us][move.from_to()]
+                          + (*contHist[0])[movedPiece][move.to_sq()]
+                          + (*contHist[1])[movedPiece][move.to_sq()] - 4241;
+
+        r += 330 - PvNode * 1024 + sp.cutNode * 3179 - ss->statScore * 2652 / 18912;
+
+        // Reduced null window search, then full depth if it fails high
+        Depth d = std::max(1, std::min(newDepth - r / 1024, newDepth));
+
+        value = -search<NonPV>(pos, ss + 1, -(alpha + 1), -alpha, d, true);
+
+        if (value > alpha && d < newDepth)
+            value = -search<NonPV>(pos, ss + 1, -(alpha + 1), -alpha, newDepth, !sp.cutNode);
+
+        if (PvNode && value > alpha)
+        {
+            (ss + 1)->pv    = pv;
+            (ss + 1)->pv[0] = Move::none();
+
+            value = -search<PV>(pos, ss + 1, -sp.beta, -alpha, newDepth, false);
+        }
+
+        pos.undo_move(move);
+
+        assert(value > -VALUE_INFINITE && value < VALUE_INFINITE);
+
+        // The value cannot be trusted if the search was stopped or if another
+        // thread already found a cutoff here or at an ancestor split point.
+        if (threads.stop.load(std::memory_order_relaxed) || cutoff_occurred())
+            break;
+
+        std::lock_guard<std::mutex> lock(sp.mutex);
+
+        if (value > sp.bestValue)
+        {
+            sp.bestValue = value;
+
+            if (value > sp.alpha)
+            {
+                sp.bestMove = move;
+
+                if (PvNode)
+                    update_pv(sp.ss->pv, move, (ss + 1)->pv);
+
+                if (value >= sp.beta)
+                    sp.cutoff = true;
+                else
+                    sp.alpha = value;
+            }
+        }
+    }
+
+    activeSplitPoint = parentSplitPoint;
+}
+
+
+// Loop of the helper threads in YBWC mode. Instead of running their own
+// iterative deepening, they join the split points created by other threads.
+void Search::Worker::help_split_points() {
+
+    ++threads.idleHelpers;
+
+    while (!threads.stop.load(std::memory_order_relaxed))
+    {
+        SplitPoint* sp = threads.join_split_point();
+
+        if (!sp)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        --threads.idleHelpers;
+
+        if (sp->pvNode)
+            search_split_point<PV>(*sp);
+        else
+            search_split_point<NonPV>(*sp);
+
+        ++threads.idleHelpers;
+        sp->helpers.fetch_sub(1, std::memory_order_release);
+    }
+
+    --threads.idleHelpers;
+}
+
+
+// Whether a beta cutoff made the search at the current split point, or at one
+// of its ancestors, useless.
+bool Search::Worker::cutoff_occurred() const {
+
+    for (const SplitPoint* sp = activeSplitPoint; sp; sp = sp->parent)
+        if (sp->cutoff.load(std::memory_order_relaxed))
+            return true;
+
+    return false;
+}
+
+
+// Best-first search of the "Parallel Search" BestFirst mode, run by every
+// thread on the shared tree. Each iteration selects a path by PUCT, expands its
+// last node with the moves in MovePicker order as priors, values it with a
+// shallow alpha-beta search and backs the score up the path. The main thread
+// reports the most visited lines as the principal variations.
+void Search::Worker::best_first_search() {
+
+    constexpr Depth LeafDepth   = 2;
+    constexpr int   MaxTreePly  = MAX_PLY / 2;
+    constexpr int   ReportEvery = 256;  // Iterations between two depth checks
+
+    MCTS::Tree&    tree       = threads.bestFirstTree;
+    SearchManager* mainThread = is_mainthread() ? main_manager() : nullptr;
+    Position&      pos        = rootPos;
+
+    std::vector<StateInfo> states(MaxTreePly);
+    std::vector<Move>      moves;
+    MCTS::Node*            path[MaxTreePly + 1];
+    Move                   pv[MAX_PLY + 1];
+    Stack                  stack[MAX_PLY + 10] = {};
+    Stack*                 ss                  = stack + 7;
+
+    // See iterative_deepening()
+    for (int i = 7; i > 0; --i)
+    {
+        (ss - i)->continuationHistory           = &continuationHistory[0][0][NO_PIECE][0];
+        (ss - i)->continuationCorrectionHistory = &continuationCorrectionHistory[NO_PIECE][0];
+        (ss - i)->staticEval                    = VALUE_NONE;
+    }
+
+    for (int i = 0; i <= MAX_PLY + 2; ++i)
+        (ss + i)->ply = i;
+
+    // The leaf searches run with a full window, as at the root of an iteration
+    rootDepth = completedDepth = LeafDepth;
+    rootDelta                  = 2 * VALUE_INFINITE;
+    optimism[WHITE] = optimism[BLACK] = VALUE_ZERO;
+
+    // Updates the root moves from the statistics of the root children, most
+    // visited first, and returns the length of the principal variation.
+    auto update_root_moves = [&]() {
+        for (const MCTS::Node& child : *tree.root())
+        {
+            RootMove& rm = *std::find(rootMoves.begin(), rootMoves.end(), child.move);
+
+            rm.effort   = child.visits.load(std::memory_order_relaxed);
+            rm.score    = rm.uciScore = rm.effort ? MCTS::to_value(child.q()) : -VALUE_INFINITE;
+            rm.selDepth = selDepth;
+            rm.pv       = tree.pv(child);
+        }
+
+        std::stable_sort(rootMoves.begin(), rootMoves.end(),
+                         [](const RootMove& a, const RootMove& b) { return a.effort > b.effort; });
+
+        return int(rootMoves[0].pv.size());
+    };
+
+    TimePoint lastReport = 0;
+
+    for (int iteration = 1; !threads.stop.load(std::memory_order_relaxed); ++iteration)
+    {
+        if (mainThread)
+        {
+            mainThread->check_time(*this);
+
+            if (iteration % ReportEvery == 0 && tree.root()->expanded())
+            {
+                int depth = update_root_moves();
+
+                if (elapsed_time() - lastReport > 1000)
+                {
+                    lastReport = elapsed_time();
+                    mainThread->pv(*this, threads, tt, depth);
+                }
+
+                // A depth limit is reached once the principal variation is that
+                // long, or once the tree cannot grow anymore.
+                if (limits.depth && (depth >= limits.depth || tree.full()))
+                    threads.stop = true;
+            }
+        }
+
+        sync_network();
+
+        // Selection
+        int         ply  = 0;
+        MCTS::Node* node = path[0] = tree.root();
+
+        while (node->expanded() && ply < MaxTreePly)
+        {
+            node   = tree.select(*node);
+            Move m = node->move;
+
+            (ss + ply)->currentMove = m;
+            (ss + ply)->inCheck     = bool(pos.checkers());
+            (ss + ply)->staticEval  = VALUE_NONE;
+            (ss + ply)->continuationHistory =
+              &continuationHistory[(ss + ply)->inCheck][pos.capture(m)][pos.moved_piece(m)]
+                                  [m.to_sq()];
+            (ss + ply)->continuationCorrectionHistory =
+              &continuationCorrectionHistory[pos.moved_piece(m)][m.to_sq()];
+
+            count_node();
+            pos.do_move(m, states[ply]);
+            path[++ply] = node;
+        }
+
+        // Expansion and evaluation of the leaf, from the side to move
+        Value value;
+        bool  aborted = false;
+
+        if (!ply || !pos.rule_judge(value, ply))
+        {
+            auto [ttHit, ttData, ttWriter] = tt.probe(pos.key());
+
+            const PieceToHistory* contHist[] = {(ss + ply - 1)->continuationHistory,
+                                                (ss + ply - 2)->continuationHistory,
+                                                (ss + ply - 3)->continuationHistory,
+                                                (ss + ply - 4)->continuationHistory,
+                                                nullptr,
+                                                (ss + ply - 6)->continuationHistory};
+
+            MovePicker mp(pos, ttData.move, LeafDepth, &mainHistory, &lowPlyHistory,
+                          &captureHistory, contHist, &pawnHistory, ply);
+
+            moves.clear();
+            for (Move m; (m = mp.next_move()) != Move::none();)
+                if (pos.legal(m)
+                    && (ply || std::count(rootMoves.begin(), rootMoves.end(), m)))
+                    moves.push_back(m);
+
+            if (moves.empty())
+                value = mated_in(ply);
+            else
+            {
+                if (!tree.full())
+                    tree.expand(*node, moves);
+
+                (ss + ply)->pv = pv;
+                value =
+                  search<PV>(pos, ss + ply, -VALUE_INFINITE, VALUE_INFINITE, LeafDepth, false);
+                aborted = stopped();
+            }
+        }
+
+        for (int i = ply; i > 0; --i)
+            pos.undo_move(path[i]->move);
+
+        // A leaf search interrupted by the stop returns no real score
+        if (aborted)
+            tree.revert(path, ply + 1);
+        else
+            tree.backup(path, ply + 1, MCTS::to_score(value));
+    }
+
+    if (mainThread && tree.root()->expanded())
+        completedDepth = update_root_moves();
+}
+
+
 Depth Search::Worker::reduction(bool i, Depth d, int mn, int delta) const {
     int reductionScale = reductions[d] * reductions[mn];
     return reductionScale - delta * 1181 / rootDelta + !i * reductionScale / 3 + 2199;
@@ -1869,13 +2661,14 @@ Depth Search::Worker::reduction(bool i, Depth d, int mn, int delta) const {
 // This function is intended for use only when printing PV outputs, and not used
 // for making decisions within the search algorithm itself.
 TimePoint Search::Worker::elapsed() const {
-    return main_manager()->tm.elapsed([this]() { return threads.nodes_searched(); });
+    return main_manager()->tm.elapsed(
+      [this]() { return threads.nodes_searched() + unpublished_nodes(); });
 }
 
 TimePoint Search::Worker::elapsed_time() const { return main_manager()->tm.elapsed_time(); }
 
 Value Search::Worker::evaluate(const Position& pos) {
-    return Eval::evaluate(network[numaAccessToken], pos, refreshTable,
+    return Eval::evaluate((*network)[numaAccessToken], pos, refreshTable,
                           optimism[pos.side_to_move()]);
 }
 
@@ -2012,7 +2805,13 @@ void SearchManager::check_time(Search::Worker& worker) {
 
     static TimePoint lastInfoTime = now();
 
-    TimePoint elapsed = tm.elapsed([&worker]() { return worker.threads.nodes_searched(); });
+    // The nodes of the main thread are exact, the ones of the other threads lag
+    // behind by less than NodesPerPublication each.
+    const auto nodes = [&worker]() {
+        return worker.threads.nodes_searched() + worker.unpublished_nodes();
+    };
+
+    TimePoint elapsed = tm.elapsed(nodes);
     TimePoint tick    = worker.limits.startTime + elapsed;
 
     if (tick - lastInfoTime >= 1000)
@@ -2031,7 +2830,7 @@ void SearchManager::check_time(Search::Worker& worker) {
       worker.completedDepth >= 1
       && ((worker.limits.use_time_management() && (elapsed > tm.maximum() || stopOnPonderhit))
           || (worker.limits.movetime && elapsed >= worker.limits.movetime)
-          || (worker.limits.nodes && worker.threads.nodes_searched() >= worker.limits.nodes)))
+          || (worker.limits.nodes && nodes() >= worker.limits.nodes)))
         worker.threads.stop = worker.threads.abortedSearch = true;
 }
 
@@ -2040,7 +2839,10 @@ void SearchManager::pv(const Search::Worker&     worker,
                        const TranspositionTable& tt,
                        Depth                     depth) const {
 
-    const auto  nodes     = threads.nodes_searched();
+    // The info lines are printed by the main thread, whose own nodes are exact
+    const auto nodes =
+      threads.nodes_searched() + threads.main_thread()->worker->unpublished_nodes();
+
     const auto& rootMoves = worker.rootMoves;
     const auto& pos       = worker.rootPos;
     size_t      pvIdx     = worker.pvIdx;
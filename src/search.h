@@ -25,7 +25,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -52,9 +54,20 @@ enum NodeType {
 class TranspositionTable;
 class ThreadPool;
 class OptionsMap;
+class MovePicker;
 
 namespace Search {
 
+// Each worker counts its nodes in a plain counter of its own, and adds them to
+// the counter of its NUMA node every NodesPerPublication nodes and at the end
+// of its search. The totals read during a search, for 'go nodes', 'nodestime'
+// and the info lines, are then short of at most NodesPerPublication - 1 nodes
+// per thread other than the main thread.
+constexpr uint64_t NodesPerPublication = 1024;
+
+static_assert((NodesPerPublication & (NodesPerPublication - 1)) == 0,
+              "NodesPerPublication has to be a power of 2");
+
 // Stack struct keeps track of the information we need to remember from nodes
 // shallower and deeper in the tree during the search. Each search thread has
 // its own array of Stack objects, indexed by the current ply.
@@ -128,23 +141,82 @@ struct LimitsType {
 // The UCI stores the uci options, thread pool, and transposition table.
 // This struct is used to easily forward data to the Search::Worker class.
 struct SharedState {
-    SharedState(const OptionsMap&                              optionsMap,
-                ThreadPool&                                    threadPool,
-                TranspositionTable&                            transpositionTable,
-                const LazyNumaReplicated<Eval::NNUE::Network>& net) :
+    SharedState(const OptionsMap&                                        optionsMap,
+                ThreadPool&                                              threadPool,
+                TranspositionTable&                                      transpositionTable,
+                const DoubleBufferedNumaReplicated<Eval::NNUE::Network>& nets) :
         options(optionsMap),
         threads(threadPool),
         tt(transpositionTable),
-        network(net) {}
+        networks(nets) {}
 
-    const OptionsMap&                              options;
-    ThreadPool&                                    threads;
-    TranspositionTable&                            tt;
-    const LazyNumaReplicated<Eval::NNUE::Network>& network;
+    const OptionsMap&                                        options;
+    ThreadPool&                                              threads;
+    TranspositionTable&                                      tt;
+    const DoubleBufferedNumaReplicated<Eval::NNUE::Network>& networks;
+};
+
+// Per-worker part of a suspended search, see ThreadPool::suspend(). Besides the
+// root moves and the last completed iteration it keeps a copy of the histories,
+// because the search that runs in the meantime keeps updating the live ones.
+struct WorkerSnapshot {
+    ButterflyHistory mainHistory;
+    LowPlyHistory    lowPlyHistory;
+
+    CapturePieceToHistory captureHistory;
+    ContinuationHistory   continuationHistory[2][2];
+    PawnHistory           pawnHistory;
+
+    CorrectionHistory<Pawn>         pawnCorrectionHistory;
+    CorrectionHistory<Major>        majorPieceCorrectionHistory;
+    CorrectionHistory<Minor>        minorPieceCorrectionHistory;
+    CorrectionHistory<NonPawn>      nonPawnCorrectionHistory[COLOR_NB];
+    CorrectionHistory<Continuation> continuationCorrectionHistory;
+
+    RootMoves rootMoves;
+    Depth     completedDepth;
+    uint64_t  nodes;
+};
+
+// Outcome of a search run by a worker on its own, see Worker::search_alone()
+struct BatchResult {
+    Move        bestMove = Move::none();
+    Score       score;
+    Depth       depth  = 0;
+    uint64_t    nodes  = 0;
+    TimePoint   timeMs = 0;
+    std::string error;  // Set, and nothing searched, if the position is invalid
 };
 
 class Worker;
 
+// A node whose remaining moves are searched in parallel by the thread that
+// created it and by idle threads joining it ("Parallel Search" set to YBWC).
+// Following Young Brothers Wait, a node is only split once its first move has
+// been searched. The owner waits at the split point until every helper left it.
+struct SplitPoint {
+
+    // Set by the owner before the split point is published, read-only afterwards
+    Position*   pos;
+    Stack*      ss;
+    Worker*     owner;
+    SplitPoint* parent;
+    MovePicker* movePicker;
+    Depth       depth;
+    Value       beta;
+    bool        pvNode, cutNode, improving;
+
+    // Shared data, protected by the mutex
+    std::mutex mutex;
+    Value      alpha, bestValue;
+    Move       bestMove;
+    int        moveCount;
+    bool       allMovesPicked;
+
+    std::atomic<int> helpers;  // Threads other than the owner searching here
+    std::atomic_bool cutoff;
+};
+
 // Null Object Pattern, implement a common interface for the SearchManagers.
 // A Null Object will be given to non-mainthread workers.
 class ISearchManager {
@@ -241,10 +313,36 @@ class Worker {
     // It searches from the root position and outputs the "bestmove".
     void start_searching();
 
-    bool is_mainthread() const { return threadIdx == 0; }
+    // A worker searching on its own is never the main thread of the pool
+    bool is_mainthread() const { return threadIdx == 0 && !standalone; }
+
+    // Searches the position on the calling thread only, independently of the
+    // other threads of the pool, which may be searching other positions at the
+    // same time. Nothing is printed. The search stops once 'limits.depth' is
+    // completed, 'limits.nodes' have been searched or 'limits.movetime' has
+    // elapsed since the call. 'onIteration', if any, is called at the end of
+    // every completed iteration. Used by the batch searches of ThreadPool.
+    BatchResult search_alone(const Position&                                pos,
+                             const LimitsType&                              limits,
+                             const std::function<void(const BatchResult&)>& onIteration = {});
 
     void ensure_network_replicated();
 
+    // Switches to the network published last, if not already using it. Called
+    // between two iterations, so that a new network is picked up during the
+    // search without mixing its accumulators with the ones of the old network.
+    void sync_network();
+
+    // Save the state of an interrupted search, and restore it so that iterative
+    // deepening continues after the last completed depth.
+    void save(WorkerSnapshot&) const;
+    void restore(const WorkerSnapshot&);
+
+    // Write and read the histories in a compact binary format, so that a new
+    // process does not start its first game with empty histories.
+    void save_histories(std::ostream&) const;
+    bool load_histories(std::istream&);
+
     // Public because they need to be updatable by the stats
     ButterflyHistory mainHistory;
     LowPlyHistory    lowPlyHistory;
@@ -262,6 +360,11 @@ class Worker {
    private:
     void iterative_deepening();
 
+    // A worker searching on its own stops without stopping the pool
+    bool stopped() const;
+
+    BatchResult batch_result() const;
+
     // This is the main search function, for both PV and non-PV nodes
     template<NodeType nodeType>
     Value search(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode);
@@ -283,12 +386,48 @@ class Worker {
 
     Value evaluate(const Position&);
 
+    // Young Brothers Wait parallel search, see SplitPoint
+    template<NodeType nodeType>
+    void split(Position&   pos,
+               Stack*      ss,
+               Value&      alpha,
+               Value       beta,
+               Value&      bestValue,
+               Move&       bestMove,
+               Depth       depth,
+               int&        moveCount,
+               MovePicker& mp,
+               bool        cutNode,
+               bool        improving);
+
+    template<NodeType nodeType>
+    void search_split_point(SplitPoint& sp);
+
+    void help_split_points();
+    bool cutoff_occurred() const;
+
+    void use_network(const LazyNumaReplicated<Eval::NNUE::Network>& net, uint32_t generation);
+
+    void count_node() {
+        if (!(++nodes & (NodesPerPublication - 1)))
+            publish_nodes();
+    }
+    void     publish_nodes();
+    uint64_t unpublished_nodes() const { return nodes - publishedNodes; }
+
+    // Best-first search on the tree shared by all the threads
+    void best_first_search();
+
     LimitsType limits;
 
     size_t                pvIdx, pvLast;
-    std::atomic<uint64_t> nodes, bestMoveChanges;
+    uint64_t              nodes, publishedNodes = 0;
+    std::atomic<uint64_t> bestMoveChanges;
     int                   selDepth, nmpMinPly;
 
+    // The node counter of the NUMA node of the thread, see count_node()
+    std::atomic<uint64_t>* nodeCounter = nullptr;
+
     Value optimism[COLOR_NB];
 
     Position  rootPos;
@@ -296,6 +435,14 @@ class Worker {
     RootMoves rootMoves;
     Depth     rootDepth, completedDepth;
     Value     rootDelta;
+    bool      resumed        = false;
+    bool      standalone     = false;
+    bool      standaloneStop = false;
+
+    std::function<void(const BatchResult&)> onIteration;
+
+    SplitPoint* activeSplitPoint = nullptr;
+    int         splitPointsSize  = 0;
 
     size_t                    threadIdx;
     NumaReplicatedAccessToken numaAccessToken;
@@ -306,10 +453,15 @@ class Worker {
     // The main thread has a SearchManager, the others have a NullSearchManager
     std::unique_ptr<ISearchManager> manager;
 
-    const OptionsMap&                              options;
-    ThreadPool&                                    threads;
-    TranspositionTable&                            tt;
-    const LazyNumaReplicated<Eval::NNUE::Network>& network;
+    const OptionsMap&                                        options;
+    ThreadPool&                                              threads;
+    TranspositionTable&                                      tt;
+    const DoubleBufferedNumaReplicated<Eval::NNUE::Network>& networks;
+
+    // The network in use, its generation and when the worker switched to it
+    const LazyNumaReplicated<Eval::NNUE::Network>* network;
+    std::atomic<uint32_t>                          networkGeneration;
+    TimePoint                                      networkSyncTime = 0;
 
     // Used by NNUE
     Eval::NNUE::AccumulatorCaches refreshTable;
@@ -22,6 +22,8 @@
 #include <cassert>
 #include <deque>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -103,6 +105,11 @@ void Thread::run_custom_job(std::function<void()> f) {
 
 void Thread::ensure_network_replicated() { worker->ensure_network_replicated(); }
 
+bool Thread::is_searching() {
+    std::lock_guard<std::mutex> lk(mutex);
+    return searching;
+}
+
 // Thread gets parked here, blocked on the condition variable
 // when the thread has no work to do.
 
@@ -129,7 +136,18 @@ void Thread::idle_loop() {
 
 Search::SearchManager* ThreadPool::main_manager() { return main_thread()->worker->main_manager(); }
 
-uint64_t ThreadPool::nodes_searched() const { return accumulate(&Search::Worker::nodes); }
+uint64_t ThreadPool::nodes_searched() const {
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < nodeCounterCount; ++i)
+        sum += nodeCounters[i].nodes.load(std::memory_order_relaxed);
+    return sum;
+}
+
+void ThreadPool::reset_node_counters() {
+    for (size_t i = 0; i < nodeCounterCount; ++i)
+        nodeCounters[i].nodes = 0;
+}
 
 // Creates/destroys threads to match the requested number.
 // Created and launched threads will immediately go to sleep in idle_loop.
@@ -145,6 +163,9 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
         threads.clear();
 
         boundThreadToNumaNode.clear();
+
+        // Snapshots are per thread, they can't be resumed with a different pool
+        discard_suspended();
     }
 
     const size_t requested = sharedState.options["Threads"];
@@ -173,6 +194,12 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
                                 ? numaConfig.distribute_threads_among_numa_nodes(requested)
                                 : std::vector<NumaIndex>{};
 
+        nodeCounterCount =
+          doBindThreads
+            ? *std::max_element(boundThreadToNumaNode.begin(), boundThreadToNumaNode.end()) + 1
+            : 1;
+        nodeCounters = std::make_unique<NodeCounter[]>(nodeCounterCount);
+
         while (threads.size() < requested)
         {
             const size_t    threadId = threads.size();
@@ -190,6 +217,8 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
 
             threads.emplace_back(
               std::make_unique<Thread>(sharedState, std::move(manager), threadId, binder));
+
+            threads.back()->worker->nodeCounter = &nodeCounters[numaId].nodes;
         }
 
         clear();
@@ -242,6 +271,7 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states, Search::Lim
     main_manager()->ponder                                 = limits.ponderMode;
 
     increaseDepth = true;
+    reset_node_counters();
 
     Search::RootMoves rootMoves;
     const auto        legalmoves = MoveList<LEGAL>(pos);
@@ -260,11 +290,15 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states, Search::Lim
 
     // After ownership transfer 'states' becomes empty, so if we stop the search
     // and call 'go' again without setting a new position states.get() == nullptr.
-    assert(states.get() || setupStates.get());
+    // If that search has been suspended in the meantime, its snapshot owns them.
+    assert(states.get() || setupStates.get() || !suspended.empty());
 
     if (states.get())
         setupStates = std::move(states);  // Ownership transfer, states is now empty
 
+    const StateInfo& rootState =
+      setupStates.get() ? setupStates->back() : suspended.back()->states->back();
+
     // We use Position::set() to set root position across threads. But there are
     // some StateInfo fields (previous, pliesFromNull, capturedPiece) that cannot
     // be deduced from a fen string, so set() clears them and they are set from
@@ -274,11 +308,13 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states, Search::Lim
     {
         th->run_custom_job([&]() {
             th->worker->limits = limits;
-            th->worker->nodes = th->worker->nmpMinPly = th->worker->bestMoveChanges = 0;
+            th->worker->nodes = th->worker->publishedNodes = 0;
+            th->worker->nmpMinPly = th->worker->bestMoveChanges = 0;
             th->worker->rootDepth = th->worker->completedDepth = 0;
             th->worker->rootMoves                              = rootMoves;
+            th->worker->resumed                                = false;
             th->worker->rootPos.set(pos, &th->worker->rootState);
-            th->worker->rootState = setupStates->back();
+            th->worker->rootState = rootState;
         });
     }
 
@@ -288,6 +324,92 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states, Search::Lim
     main_thread()->start_searching();
 }
 
+std::vector<Search::BatchResult> ThreadPool::search_batch(const std::vector<BatchJob>& jobs,
+                                                          const Search::LimitsType&    limits,
+                                                          size_t                       concurrency,
+                                                          const BatchIteration&        onIteration) {
+
+    main_thread()->wait_for_search_finished();
+
+    // The positions are unrelated, so a thread never stops the others, never
+    // shortens its iterations and never splits its tree with them.
+    stop = abortedSearch = false;
+    increaseDepth        = true;
+    parallelSearch       = ParallelSearch::LazySMP;
+
+    std::vector<Search::BatchResult> results(jobs.size());
+    std::atomic<size_t>              next(0);
+
+    const size_t used = concurrency ? std::min(concurrency, threads.size()) : threads.size();
+
+    for (size_t i = 0; i < used; ++i)
+        run_on_thread(i, [&, worker = threads[i]->worker.get()]() {
+            for (size_t j; (j = next++) < jobs.size();)
+            {
+                const auto& [fen, moves] = jobs[j];
+
+                Position     pos;
+                StateListPtr states(new std::deque<StateInfo>(1));
+                pos.set(fen, &states->back());
+
+                for (const auto& move : moves)
+                {
+                    auto m = UCIEngine::to_move(pos, move);
+
+                    if (m == Move::none())
+                    {
+                        results[j].error = "illegal move " + move;
+                        break;
+                    }
+
+                    states->emplace_back();
+                    pos.do_move(m, states->back());
+                }
+
+                // Searching the position before the illegal move would answer
+                // another question than the one asked.
+                if (!results[j].error.empty())
+                    continue;
+
+                if (onIteration)
+                    results[j] = worker->search_alone(
+                      pos, limits, [&, j](const auto& r) { onIteration(j, r); });
+                else
+                    results[j] = worker->search_alone(pos, limits);
+            }
+        });
+
+    for (size_t i = 0; i < used; ++i)
+        wait_on_thread(i);
+
+    return results;
+}
+
+void ThreadPool::save_histories(std::ostream& stream) const {
+    main_thread()->wait_for_search_finished();
+    main_thread()->worker->save_histories(stream);
+}
+
+// Each thread decodes its own copy, so that its histories are allocated on the
+// NUMA node it is bound to.
+bool ThreadPool::load_histories(const std::string& data) {
+
+    main_thread()->wait_for_search_finished();
+
+    std::vector<char> loaded(threads.size());
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        run_on_thread(i, [&, i]() {
+            std::istringstream stream(data);
+            loaded[i] = threads[i]->worker->load_histories(stream);
+        });
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        wait_on_thread(i);
+
+    return std::all_of(loaded.begin(), loaded.end(), [](char ok) { return ok; });
+}
+
 Thread* ThreadPool::get_best_thread() const {
 
     Thread* bestThread = threads.front().get();
@@ -373,6 +495,40 @@ void ThreadPool::wait_for_search_finished() const {
             th->wait_for_search_finished();
 }
 
+
+void ThreadPool::push_split_point(Search::SplitPoint* sp) {
+
+    std::lock_guard<std::mutex> lock(splitPointsMutex);
+    splitPoints.push_back(sp);
+}
+
+void ThreadPool::remove_split_point(Search::SplitPoint* sp) {
+
+    std::lock_guard<std::mutex> lock(splitPointsMutex);
+    splitPoints.erase(std::find(splitPoints.begin(), splitPoints.end(), sp));
+}
+
+// Returns a split point the calling thread has joined, or nullptr if there is
+// none. The oldest split points are closest to the root and have the largest
+// subtrees, so they are tried first. The number of helpers of a split point is
+// limited, as they all contend for its lock.
+Search::SplitPoint* ThreadPool::join_split_point() {
+
+    constexpr int MaxHelpersPerSplitPoint = 8;
+
+    std::lock_guard<std::mutex> lock(splitPointsMutex);
+
+    for (Search::SplitPoint* sp : splitPoints)
+        if (!sp->cutoff.load(std::memory_order_relaxed)
+            && sp->helpers.load(std::memory_order_relaxed) < MaxHelpersPerSplitPoint)
+        {
+            sp->helpers.fetch_add(1, std::memory_order_relaxed);
+            return sp;
+        }
+
+    return nullptr;
+}
+
 std::vector<size_t> ThreadPool::get_bound_thread_count_by_numa_node() const {
     std::vector<size_t> counts;
 
@@ -397,4 +553,172 @@ void ThreadPool::ensure_network_replicated() {
         th->ensure_network_replicated();
 }
 
+bool ThreadPool::searching() const { return !threads.empty() && main_thread()->is_searching(); }
+
+// The time at which the last worker switched to the network of the given
+// generation, none if some worker still uses an older network.
+std::optional<TimePoint> ThreadPool::network_sync_time(uint32_t generation) const {
+
+    TimePoint syncTime = 0;
+
+    for (auto&& th : threads)
+    {
+        if (th->worker->networkGeneration.load(std::memory_order_acquire) != generation)
+            return std::nullopt;
+
+        syncTime = std::max(syncTime, th->worker->networkSyncTime);
+    }
+
+    return syncTime;
+}
+
+// Opens hardware performance counters on every thread. Counters measure the
+// thread that opens them, so this is done from within each thread.
+void ThreadPool::start_perf_counters() {
+
+    perfCounters.clear();
+    perfCounters.resize(threads.size());
+
+    // The vector is filled before any job starts, the jobs only see their own
+    // counters.
+    for (auto& pc : perfCounters)
+        pc = std::make_unique<PerfCounters::ThreadCounters>();
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        run_on_thread(i, [pc = perfCounters[i].get()]() { pc->open(); });
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        wait_on_thread(i);
+}
+
+// Reads and closes the counters opened by start_perf_counters(), returning
+// the sum over all threads.
+PerfCounters::Sample ThreadPool::stop_perf_counters() {
+
+    PerfCounters::Sample sample;
+
+    for (auto&& pc : perfCounters)
+        sample += pc->read();
+
+    perfCounters.clear();
+
+    return sample;
+}
+
+// Stops the running search without reporting a best move and saves everything
+// needed to continue it later. Returns false if there was no search to suspend,
+// e.g. because it had already finished, or if MaxSuspendedSearches are already
+// suspended, the running search then going on undisturbed.
+bool ThreadPool::suspend() {
+
+    if (!can_suspend())
+        return false;
+
+    searchSuspended  = false;
+    suspendRequested = true;
+    stop             = true;
+
+    main_thread()->wait_for_search_finished();
+
+    suspendRequested = false;
+
+    if (!searchSuspended)
+        return false;
+
+    searchSuspended = false;
+
+    auto            s    = std::make_unique<SuspendedSearch>();
+    Search::Worker& main = *main_thread()->worker;
+
+    s->rootPos.set(main.rootPos, &s->rootState);
+    s->rootState                = main.rootState;
+    s->states                   = std::move(setupStates);
+    s->limits                   = main.limits;
+    s->elapsed                  = now() - main.limits.startTime;
+    s->ponder                   = main_manager()->ponder;
+    s->bestPreviousScore        = main_manager()->bestPreviousScore;
+    s->bestPreviousAverageScore = main_manager()->bestPreviousAverageScore;
+    s->previousTimeReduction    = main_manager()->previousTimeReduction;
+    s->originalTimeAdjust       = main_manager()->originalTimeAdjust;
+
+    // Histories are copied by their own threads to keep them NUMA local
+    s->workers.resize(threads.size());
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        run_on_thread(i, [this, &s, i]() {
+            s->workers[i] = std::make_unique<Search::WorkerSnapshot>();
+            threads[i]->worker->save(*s->workers[i]);
+        });
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        wait_on_thread(i);
+
+    suspended.push_back(std::move(s));
+    return true;
+}
+
+// Continues the most recently suspended search from its last completed depth.
+// The time spent before the suspension counts against the time limits. The
+// setup states of the last search are handed over to 'states' if it is empty,
+// because the caller's position may still refer to them.
+bool ThreadPool::resume(StateListPtr& states) {
+
+    main_thread()->wait_for_search_finished();
+
+    if (suspended.empty())
+        return false;
+
+    std::unique_ptr<SuspendedSearch> s = std::move(suspended.back());
+    suspended.pop_back();
+
+    if (!states.get())
+        states = std::move(setupStates);
+
+    setupStates = std::move(s->states);
+
+    main_manager()->stopOnPonderhit = stop = abortedSearch = false;
+    main_manager()->ponder                   = s->ponder;
+    main_manager()->bestPreviousScore        = s->bestPreviousScore;
+    main_manager()->bestPreviousAverageScore = s->bestPreviousAverageScore;
+    main_manager()->previousTimeReduction    = s->previousTimeReduction;
+    main_manager()->originalTimeAdjust       = s->originalTimeAdjust;
+
+    increaseDepth = true;
+
+    // The restored workers publish their node counts again from zero
+    reset_node_counters();
+
+    Search::LimitsType limits = s->limits;
+    limits.startTime          = now() - s->elapsed;
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        run_on_thread(i, [this, &s, &limits, i]() {
+            Search::Worker& w = *threads[i]->worker;
+            w.limits          = limits;
+            w.restore(*s->workers[i]);
+            w.rootPos.set(s->rootPos, &w.rootState);
+            w.rootState = s->rootState;
+
+            // It may have been computed with a network swapped out since
+            w.rootState.accumulator.computed[WHITE] = false;
+            w.rootState.accumulator.computed[BLACK] = false;
+        });
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        wait_on_thread(i);
+
+    main_thread()->start_searching();
+    return true;
+}
+
+// Drops all suspended searches. The caller's position may refer to the setup
+// states of the most recent one, so these are kept alive in that case.
+void ThreadPool::discard_suspended() {
+
+    if (!suspended.empty() && !setupStates.get())
+        setupStates = std::move(suspended.back()->states);
+
+    suspended.clear();
+}
+
 }  // namespace Stockfish
@@ -23,12 +23,19 @@
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <iosfwd>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "mcts.h"
 #include "numa.h"
+#include "perfcounters.h"
 #include "position.h"
 #include "search.h"
 #include "thread_win32_osx.h"
@@ -82,6 +89,7 @@ class Thread {
     void run_custom_job(std::function<void()> f);
 
     void ensure_network_replicated();
+    bool is_searching();
 
     // Thread has been slightly altered to allow running custom jobs, so
     // this name is no longer correct. However, this class (and ThreadPool)
@@ -104,6 +112,29 @@ class Thread {
 };
 
 
+// A search interrupted by ThreadPool::suspend(). It owns the setup states of
+// the search, so that the root position keeps its game history, and saves the
+// part of the main manager that the searches run in the meantime overwrite.
+struct SuspendedSearch {
+    StateListPtr       states;
+    Position           rootPos;
+    StateInfo          rootState;
+    Search::LimitsType limits;
+    TimePoint          elapsed;
+    bool               ponder;
+    Value              bestPreviousScore, bestPreviousAverageScore;
+    double             previousTimeReduction, originalTimeAdjust;
+
+    std::vector<std::unique_ptr<Search::WorkerSnapshot>> workers;
+};
+
+// Parallel search algorithms, see the "Parallel Search" option
+enum class ParallelSearch {
+    LazySMP,
+    YBWC,
+    BestFirst
+};
+
 // ThreadPool struct handles all the threads-related stuff like init, starting,
 // parking and, most importantly, launching a thread. All the access to threads
 // is done through this class.
@@ -145,9 +176,57 @@ class ThreadPool {
 
     std::vector<size_t> get_bound_thread_count_by_numa_node() const;
 
+    // Searches many independent positions, each given as a fen and the moves
+    // played from it, every thread taking the next position once it is done
+    // with its own. At most 'concurrency' threads are used if it is not 0, and
+    // 'onIteration' is called with the index of the position at the end of
+    // each iteration. A position with an illegal move is not searched, its
+    // result only holds the error. See Search::Worker::search_alone().
+    using BatchJob       = std::pair<std::string, std::vector<std::string>>;
+    using BatchIteration = std::function<void(size_t, const Search::BatchResult&)>;
+
+    std::vector<Search::BatchResult> search_batch(const std::vector<BatchJob>& jobs,
+                                                  const Search::LimitsType&    limits,
+                                                  size_t                       concurrency = 0,
+                                                  const BatchIteration&        onIteration = {});
+
     void ensure_network_replicated();
 
+    // Histories persisted between processes, see Search::Worker::save_histories().
+    // They are saved from the main thread and loaded into every thread.
+    void save_histories(std::ostream&) const;
+    bool load_histories(const std::string& data);
+
+    // Hot swap of the network during a search, see Search::Worker::sync_network()
+    bool                     searching() const;
+    std::optional<TimePoint> network_sync_time(uint32_t generation) const;
+
+    void                 start_perf_counters();
+    PerfCounters::Sample stop_perf_counters();
+
+    // A snapshot holds a copy of the histories of every thread, so only one
+    // search is kept suspended at a time.
+    static constexpr size_t MaxSuspendedSearches = 1;
+
+    bool   suspend();
+    bool   resume(StateListPtr&);
+    bool   can_suspend() const { return suspended.size() < MaxSuspendedSearches; }
+    size_t suspended_searches() const { return suspended.size(); }
+
+    // Split points of the YBWC search. The owners add and remove their own
+    // split points, idle threads join the oldest one that has room for them.
+    void                push_split_point(Search::SplitPoint* sp);
+    void                remove_split_point(Search::SplitPoint* sp);
+    Search::SplitPoint* join_split_point();
+
     std::atomic_bool stop, abortedSearch, increaseDepth;
+    std::atomic_bool suspendRequested{false}, searchSuspended{false};
+    std::atomic<int> idleHelpers{0};
+
+    std::atomic<ParallelSearch> parallelSearch{ParallelSearch::LazySMP};
+
+    // Shared tree of the best-first search
+    MCTS::Tree bestFirstTree;
 
     auto cbegin() const noexcept { return threads.cbegin(); }
     auto begin() noexcept { return threads.begin(); }
@@ -161,6 +240,27 @@ class ThreadPool {
     std::vector<std::unique_ptr<Thread>> threads;
     std::vector<NumaIndex>               boundThreadToNumaNode;
 
+    std::vector<std::unique_ptr<PerfCounters::ThreadCounters>> perfCounters;
+
+    // Nodes published by the threads bound to each NUMA node, a single counter
+    // when the threads are not bound. See Search::Worker::count_node().
+    struct alignas(Eval::NNUE::CacheLineSize) NodeCounter {
+        std::atomic<uint64_t> nodes{0};
+    };
+
+    std::unique_ptr<NodeCounter[]> nodeCounters;
+    size_t                         nodeCounterCount = 0;
+
+    void reset_node_counters();
+
+    // Suspended searches, the most recently suspended one is resumed first
+    std::vector<std::unique_ptr<SuspendedSearch>> suspended;
+
+    void discard_suspended();
+
+    std::mutex                      splitPointsMutex;
+    std::deque<Search::SplitPoint*> splitPoints;
+
     uint64_t accumulate(std::atomic<uint64_t> Search::Worker::* member) const {
 
         uint64_t sum = 0;
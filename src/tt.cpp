@@ -18,17 +18,33 @@
 
 #include "tt.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "memory.h"
 #include "misc.h"
 #include "thread.h"
 
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define USE_SHARED_TT
+#endif
+
 namespace Stockfish {
 
 
@@ -153,15 +169,76 @@ struct Cluster {
 
 static_assert(sizeof(Cluster) == 32, "Suboptimal Cluster size");
 
+namespace {
+
+// Returns the largest q such that q * d <= n * m, or q * d < n * m if 'strict'
+// is set, as the products may not fit in 64 bits. The floating point estimate
+// is at most a few units off, and then corrected exactly.
+uint64_t scaled_index(uint64_t n, uint64_t m, uint64_t d, bool strict) {
+
+    // Whether q * d is within the bound
+    auto below = [=](uint64_t q) {
+        const uint64_t hi = mul_hi64(q, d), bound = mul_hi64(n, m);
+        return hi < bound || (hi == bound && (strict ? q * d < n * m : q * d <= n * m));
+    };
+
+    uint64_t q = uint64_t(double(n) * double(m) / double(d));
+
+    while (q > 0 && !below(q))
+        --q;
+    while (below(q + 1))
+        ++q;
+
+    return q;
+}
+
+}  // namespace
+
+
+// The header at the start of a shared table. Processes attach to a table only if
+// its layout matches theirs, the generation is shared so that they all age the
+// entries at the same pace.
+struct TranspositionTable::SharedHeader {
+    static constexpr uint64_t Magic   = 0x5454524853464B50;  // "PKFSHRTT"
+    static constexpr uint32_t Version = 1;
+    static constexpr size_t   Size    = 4096;  // Keeps the clusters page aligned
+
+    uint64_t             magic;
+    uint32_t             version;
+    uint32_t             clusterSize;
+    uint64_t             clusterCount;
+    std::atomic<uint8_t> generation8;
+};
+
+static_assert(std::atomic<uint8_t>::is_always_lock_free,
+              "The shared generation must be updated without a process local lock");
+
 
 // Sets the size of the transposition table,
 // measured in megabytes. Transposition table consists
 // of clusters and each cluster consists of ClusterSize number of TTEntry.
-void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
-    aligned_large_pages_free(table);
+// The entries of a private table are migrated to the new one, so that resizing
+// during an analysis does not lose it. Both tables are allocated meanwhile.
+void TranspositionTable::resize(size_t             mbSize,
+                                ThreadPool&        threads,
+                                const std::string& sharedName,
+                                bool               keepEntries) {
+    Cluster* const oldTable        = header || !keepEntries ? nullptr : table;
+    const size_t   oldClusterCount = clusterCount;
+
+    table = oldTable ? nullptr : table;  // Keep the old table until it is migrated
+    release();
 
     clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
 
+    // A shared table is zero filled when created, and must keep its content when
+    // attached to, so it is neither cleared nor migrated to here.
+    if (!sharedName.empty() && attach_shared(mbSize, sharedName))
+    {
+        aligned_large_pages_free(oldTable);
+        return;
+    }
+
     table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
 
     if (!table)
@@ -170,14 +247,193 @@ void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
         exit(EXIT_FAILURE);
     }
 
-    clear(threads);
+    if (oldTable)
+    {
+        migrate(oldTable, oldClusterCount, threads);
+        aligned_large_pages_free(oldTable);
+    }
+    else
+        clear(threads);
+}
+
+
+// Fills the table with the entries of another one of 'oldCount' clusters, in a
+// multi-threaded way. Only the low 16 bits of the keys are stored, so an entry
+// cannot be placed exactly. Instead, each new cluster gets the entries of the old
+// clusters whose key range overlaps its own: when shrinking the most valuable ones
+// by the replacement strategy of probe(), when growing every entry is copied to
+// each new cluster it may belong to. The copies in a wrong cluster are no more
+// likely to cause a false hit than any other entry, and are replaced as usual.
+void TranspositionTable::migrate(const Cluster* oldTable, size_t oldCount, ThreadPool& threads) {
+    const size_t threadCount = threads.num_threads();
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        threads.run_on_thread(i, [this, i, threadCount, oldTable, oldCount]() {
+            const size_t stride = clusterCount / threadCount;
+            const size_t start  = stride * i;
+            const size_t len    = i + 1 != threadCount ? stride : clusterCount - start;
+
+            auto worth = [this](const TTEntry& tte) {
+                return tte.depth8 - tte.relative_age(generation8) * 2;
+            };
+
+            for (size_t c = start; c < start + len; ++c)
+            {
+                Cluster& dst = table[c];
+                std::memset(&dst, 0, sizeof(Cluster));
+
+                // Keys of cluster c are those with c <= key * clusterCount / 2^64 < c + 1
+                const uint64_t first = scaled_index(c, oldCount, clusterCount, false);
+                const uint64_t last  = scaled_index(c + 1, oldCount, clusterCount, true);
+
+                for (uint64_t o = first; o <= last; ++o)
+                    for (const TTEntry& tte : oldTable[o].entry)
+                    {
+                        if (!tte.is_occupied())
+                            continue;
+
+                        // Insertion into the entries sorted by decreasing worth
+                        int j = ClusterSize;
+                        while (j > 0 && (!dst.entry[j - 1].is_occupied()
+                                         || worth(dst.entry[j - 1]) < worth(tte)))
+                            --j;
+
+                        if (j == ClusterSize)
+                            continue;
+
+                        std::memmove(&dst.entry[j + 1], &dst.entry[j],
+                                     (ClusterSize - 1 - j) * sizeof(TTEntry));
+                        dst.entry[j] = tte;
+                    }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < threadCount; ++i)
+        threads.wait_on_thread(i);
+}
+
+
+// Maps the table from /dev/shm/pikafish-<name>, creating the file if it does not
+// exist yet. Writes between processes are as racy as between threads, so the
+// processes searching the same position cooperate like a single Lazy SMP pool.
+// The file is not removed when the engine quits, the next process using the name
+// finds the table as it was left. Returns false, with the reason in the sharing
+// status, if the table cannot be shared.
+bool TranspositionTable::attach_shared([[maybe_unused]] size_t mbSize, const std::string& name) {
+
+    static_assert(sizeof(SharedHeader) <= SharedHeader::Size);
+
+    const std::string path = "/dev/shm/pikafish-" + name;
+
+#ifdef USE_SHARED_TT
+    auto fail = [&](const std::string& reason) {
+        sharedStatus = "Cannot share the hash through " + path + ": " + reason
+                     + ", using a private table";
+        return false;
+    };
+
+    if (name.find('/') != std::string::npos)
+        return fail("the name must not contain '/'");
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return fail(std::strerror(errno));
+
+    // Serializes the initialization of the header between the processes starting together
+    flock(fd, LOCK_EX);
+
+    const size_t size = SharedHeader::Size + clusterCount * sizeof(Cluster);
+    struct stat  st;
+    bool         created = fstat(fd, &st) == 0 && st.st_size == 0;
+
+    if (created && ftruncate(fd, off_t(size)) != 0)
+    {
+        int err = errno;
+        close(fd);  // Also releases the lock
+        return fail(std::strerror(err));
+    }
+
+    if (!created && size_t(st.st_size) != size)
+    {
+        close(fd);
+        return fail("it has a size of " + std::to_string(st.st_size / (1024 * 1024))
+                    + "MB instead of " + std::to_string(mbSize) + "MB");
+    }
+
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+        int err = errno;
+        close(fd);
+        return fail(std::strerror(err));
+    }
+
+    auto* h = static_cast<SharedHeader*>(mem);
+
+    if (created)
+    {
+        h->clusterSize  = sizeof(Cluster);
+        h->clusterCount = clusterCount;
+        h->version      = SharedHeader::Version;
+        h->magic        = SharedHeader::Magic;
+        h->generation8.store(0);
+    }
+    else if (h->magic != SharedHeader::Magic || h->version != SharedHeader::Version
+             || h->clusterSize != sizeof(Cluster) || h->clusterCount != clusterCount)
+    {
+        munmap(mem, size);
+        close(fd);
+        return fail("it has an incompatible layout");
+    }
+
+    // The mapping stays valid once the file is closed
+    close(fd);
+
+    header       = h;
+    mappedSize   = size;
+    table        = reinterpret_cast<Cluster*>(static_cast<char*>(mem) + SharedHeader::Size);
+    generation8  = h->generation8.load();
+    sharedStatus = "Hash shared through " + path + (created ? " (created)" : " (attached)");
+
+    return true;
+#else
+    sharedStatus = "Cannot share the hash through " + path
+                 + ": not supported on this platform, using a private table";
+    return false;
+#endif
+}
+
+
+void TranspositionTable::release() {
+
+#ifdef USE_SHARED_TT
+    if (header)
+        munmap(header, mappedSize);
+    else
+#endif
+        aligned_large_pages_free(table);
+
+    table        = nullptr;
+    header       = nullptr;
+    mappedSize   = 0;
+    sharedStatus = "";
 }
 
 
 // Initializes the entire transposition table to zero,
-// in a multi-threaded way.
-// 清空置换表（多线程并行）
+// in a multi-threaded way. A shared table belongs to all the processes
+// attached to it, which may be searching: its entries and its generation are
+// kept, only the generation of this process is synchronized with it.
+// 清空置换表（多线程并行）；共享置换表不清空
 void TranspositionTable::clear(ThreadPool& threads) {
+    if (header)
+    {
+        generation8 = header->generation8.load();
+        return;
+    }
+
     generation8              = 0;
     const size_t threadCount = threads.num_threads();
 
@@ -216,15 +472,145 @@ int TranspositionTable::hashfull(int maxAge) const {
 }
 
 
+// Scans every cluster of the table, each thread taking its share as in clear().
+// The search may write concurrently, so the numbers are only approximate then.
+TTStats TranspositionTable::stats(ThreadPool& threads) const {
+    const size_t         threadCount = threads.num_threads();
+    std::vector<TTStats> partial(threadCount);
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        threads.run_on_thread(i, [this, i, threadCount, &partial]() {
+            const size_t stride = clusterCount / threadCount;
+            const size_t start  = stride * i;
+            const size_t len    = i + 1 != threadCount ? stride : clusterCount - start;
+
+            TTStats& s = partial[i];
+
+            for (size_t c = start; c < start + len; ++c)
+            {
+                int current = 0;
+
+                for (const TTEntry& tte : table[c].entry)
+                {
+                    if (!tte.is_occupied())
+                        continue;
+
+                    const int age = tte.relative_age(generation8) >> GENERATION_BITS;
+
+                    s.occupied++;
+                    s.pv += bool(tte.genBound8 & 0x4);
+                    s.depth[tte.depth8]++;
+                    s.age[age]++;
+                    s.bound[tte.genBound8 & 0x3]++;
+                    current += age == 0;
+                }
+
+                // A new position mapped here has to evict data of the current search
+                s.fullClusters += current == ClusterSize;
+            }
+
+            s.clusters = len;
+            s.entries  = len * ClusterSize;
+        });
+    }
+
+    TTStats total;
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        threads.wait_on_thread(i);
+        total += partial[i];
+    }
+
+    total.mbSize = clusterCount * sizeof(Cluster) / (1024 * 1024);
+    return total;
+}
+
+
+TTStats& TTStats::operator+=(const TTStats& s) {
+    clusters += s.clusters;
+    entries += s.entries;
+    occupied += s.occupied;
+    pv += s.pv;
+    fullClusters += s.fullClusters;
+
+    for (int d = 0; d < 256; ++d)
+        depth[d] += s.depth[d];
+    for (int a = 0; a < AGE_NB; ++a)
+        age[a] += s.age[a];
+    for (int b = 0; b < 4; ++b)
+        bound[b] += s.bound[b];
+
+    return *this;
+}
+
+
+std::ostream& operator<<(std::ostream& os, const TTStats& s) {
+
+    const double occupied = double(std::max(s.occupied, uint64_t(1)));
+
+    auto percent = [](uint64_t n, double total) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2) << std::setw(6) << 100.0 * n / total << "%";
+        return ss.str();
+    };
+
+    uint64_t qsearch = 0;
+    for (int d = 0; d <= DEPTH_QS - DEPTH_ENTRY_OFFSET; ++d)
+        qsearch += s.depth[d];
+
+    os << "Hash: " << s.mbSize << " MB, " << s.clusters << " clusters, " << s.entries
+       << " entries"
+       << "\nOccupied             : " << percent(s.occupied, std::max(s.entries, uint64_t(1)))
+       << " (" << s.occupied << " entries)"
+       << "\nCurrent search       : " << percent(s.age[0], std::max(s.entries, uint64_t(1)))
+       << "\nPV entries           : " << percent(s.pv, occupied) << " of occupied"
+       << "\nQSearch entries      : " << percent(qsearch, occupied) << " of occupied"
+       << "\nNo bound (eval only) : " << percent(s.bound[BOUND_NONE], occupied)
+       << "\nExact bound          : " << percent(s.bound[BOUND_EXACT], occupied)
+       << "\nLower bound          : " << percent(s.bound[BOUND_LOWER], occupied)
+       << "\nUpper bound          : " << percent(s.bound[BOUND_UPPER], occupied)
+       << "\nReplacement pressure : " << percent(s.fullClusters, std::max(s.clusters, uint64_t(1)))
+       << " of clusters hold only current search entries";
+
+    os << "\n\nDepth      Entries  Occupied";
+    for (int d = 0; d < 256; ++d)
+        if (s.depth[d])
+        {
+            const int depth = d + DEPTH_ENTRY_OFFSET;
+            os << "\n" << std::setw(5)
+               << (depth == DEPTH_UNSEARCHED ? "eval" : std::to_string(depth)) << std::setw(13)
+               << s.depth[d] << "  " << percent(s.depth[d], occupied);
+        }
+
+    os << "\n\nAge        Entries  Occupied";
+    for (int a = 0; a < TTStats::AGE_NB; ++a)
+        if (s.age[a])
+            os << "\n" << std::setw(5) << a << std::setw(13) << s.age[a] << "  "
+               << percent(s.age[a], occupied);
+
+    return os;
+}
+
+
 void TranspositionTable::new_search() {
-    // increment by delta to keep lower bits as is
-    generation8 += GENERATION_DELTA;
+    // increment by delta to keep lower bits as is. The processes sharing a table
+    // take turns to advance the common generation.
+    generation8 = header ? header->generation8.fetch_add(GENERATION_DELTA) + GENERATION_DELTA
+                         : generation8 + GENERATION_DELTA;
 }
 
 
 uint8_t TranspositionTable::generation() const { return generation8; }
 
 
+// The size of the table owned by this process, a shared mapping excluded
+size_t TranspositionTable::private_size() const {
+    return table && !header ? clusterCount * sizeof(Cluster) : 0;
+}
+
+
 // Looks up the current position in the transposition
 // table. It returns true if the position is found.
 // Otherwise, it returns false and a pointer to an empty or least valuable TTEntry
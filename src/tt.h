@@ -21,6 +21,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <iosfwd>
+#include <string>
 #include <tuple>
 
 #include "memory.h"
@@ -66,15 +68,46 @@ struct TTWriter {
 };
 
 
+// Occupancy statistics of the whole table, as gathered by TranspositionTable::stats().
+// Unlike hashfull() every cluster is scanned, so it is meant for tuning the Hash
+// size and the replacement scheme rather than for use during search.
+struct TTStats {
+    static constexpr int AGE_NB = 32;  // Number of distinct generations stored in an entry
+
+    size_t   mbSize       = 0;
+    uint64_t clusters     = 0;
+    uint64_t entries      = 0;
+    uint64_t occupied     = 0;
+    uint64_t pv           = 0;
+    uint64_t fullClusters = 0;  // Clusters holding only entries of the current search
+
+    uint64_t depth[256]  = {};  // Indexed by depth - DEPTH_ENTRY_OFFSET
+    uint64_t age[AGE_NB] = {};  // Indexed by the number of searches since the last write
+    uint64_t bound[4]    = {};
+
+    TTStats& operator+=(const TTStats& s);
+};
+
+std::ostream& operator<<(std::ostream& os, const TTStats& s);
+
+
 class TranspositionTable {
 
    public:
-    ~TranspositionTable() { aligned_large_pages_free(table); }
-
-    void resize(size_t mbSize, ThreadPool& threads);  // Set TT size
-    void clear(ThreadPool& threads);                  // Re-initialize memory, multithreaded
+    ~TranspositionTable() { release(); }
+
+    // Set TT size. With a non-empty name the table is shared with the other processes using
+    // the same name, see attach_shared(). Without 'keepEntries' the old table is freed first
+    // and its entries are lost, so that the two tables are never allocated together.
+    void resize(size_t             mbSize,
+                ThreadPool&        threads,
+                const std::string& sharedName  = "",
+                bool               keepEntries = true);
+    void clear(ThreadPool& threads);                  // Re-initialize memory, multithreaded,
+                                                      // a shared table is left as it is
     int  hashfull(int maxAge = 0)
       const;  // Approximate what fraction of entries (permille) have been written to during this root search
+    TTStats stats(ThreadPool& threads) const;  // Scan the whole table, multithreaded
 
     void
     new_search();  // This must be called at the beginning of each root search to track entry aging
@@ -84,12 +117,25 @@ class TranspositionTable {
     TTEntry* first_entry(const Key key)
       const;  // This is the hash function; its only external use is memory prefetching.
 
+    const std::string& sharing_status() const { return sharedStatus; }
+    size_t             private_size() const;  // In bytes, 0 for a shared table
+
    private:
     friend struct TTEntry;
+    struct SharedHeader;
+
+    bool attach_shared(size_t mbSize, const std::string& name);
+    void migrate(const Cluster* oldTable, size_t oldCount, ThreadPool& threads);
+    void release();
 
     size_t   clusterCount;
     Cluster* table = nullptr;
 
+    // Set when the table lives in a mapping shared between processes
+    SharedHeader* header     = nullptr;
+    size_t        mappedSize = 0;
+    std::string   sharedStatus;
+
     uint8_t generation8 = 0;  // Size must be not bigger than TTEntry::genBound8
 };
 
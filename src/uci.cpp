@@ -19,8 +19,11 @@
 #include "uci.h"
 
 #include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iterator>
 #include <optional>
 #include <sstream>
@@ -29,8 +32,10 @@
 
 #include "benchmark.h"
 #include "engine.h"
+#include "gamerecord.h"
 #include "memory.h"
 #include "movegen.h"
+#include "perfcounters.h"
 #include "position.h"
 #include "score.h"
 #include "search.h"
@@ -50,6 +55,80 @@ struct overload: Ts... {
 template<typename... Ts>
 overload(Ts...) -> overload<Ts...>;
 
+namespace {
+
+constexpr std::string_view PieceToChar(" RACPNBK racpnbk");
+
+// Helpers writing JSON directly into an output line. Strings only escape quotes,
+// backslashes and control characters, which only user input may contain.
+template<typename T>
+void append_number(std::string& out, T n) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), n);
+    out.append(buf, res.ptr);
+}
+
+void append_string(std::string& out, std::string_view str) {
+    out += '"';
+
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            constexpr std::string_view Hex("0123456789abcdef");
+            out += "\\u00";
+            out += Hex[c >> 4];
+            out += Hex[c & 0xF];
+        }
+        else
+            out += c;
+    }
+
+    out += '"';
+}
+
+// A space separated list, e.g. a PV or a WDL triple, as a JSON array
+void append_list(std::string& out, std::string_view list, bool quoted) {
+    out += '[';
+
+    for (auto item : split(list, " "))
+    {
+        if (out.back() != '[')
+            out += ',';
+
+        if (quoted)
+            append_string(out, item);
+        else
+            out += item;
+    }
+
+    out += ']';
+}
+
+// A score as a JSON object, optionally from the point of view of the opponent
+void append_score(std::string& out, const Score& s, bool negate = false) {
+    const int sign = negate ? -1 : 1;
+
+    s.visit(overload{[&](Score::Mate mate) {
+                         int plies = sign * mate.plies;
+                         out += "{\"mate\":";
+                         append_number(out, (plies > 0 ? (plies + 1) : plies) / 2);
+                         out += '}';
+                     },
+                     [&](Score::InternalUnits units) {
+                         out += "{\"cp\":";
+                         append_number(out, sign * units.value);
+                         out += '}';
+                     }});
+}
+
+}  // namespace
+
 void UCIEngine::print_info_string(std::string_view str) {
     sync_cout_start();
     for (auto& line : split(str, "\n"))
@@ -75,11 +154,21 @@ UCIEngine::UCIEngine(int argc, char** argv) :
 }
 
 void UCIEngine::init_search_update_listeners() {
-    engine.set_on_iter([](const auto& i) { on_iter(i); });
-    engine.set_on_update_no_moves([](const auto& i) { on_update_no_moves(i); });
-    engine.set_on_update_full(
-      [this](const auto& i) { on_update_full(i, engine.get_options()["UCI_ShowWDL"]); });
-    engine.set_on_bestmove([](const auto& bm, const auto& p) { on_bestmove(bm, p); });
+    const auto& options = engine.get_options();
+
+    engine.set_on_iter([&options](const auto& i) {
+        options["JSON Output"] ? on_iter_json(i) : on_iter(i);
+    });
+    engine.set_on_update_no_moves([&options](const auto& i) {
+        options["JSON Output"] ? on_update_no_moves_json(i) : on_update_no_moves(i);
+    });
+    engine.set_on_update_full([&options](const auto& i) {
+        options["JSON Output"] ? on_update_full_json(i, options["UCI_ShowWDL"])
+                               : on_update_full(i, options["UCI_ShowWDL"]);
+    });
+    engine.set_on_bestmove([&options](const auto& bm, const auto& p) {
+        options["JSON Output"] ? on_bestmove_json(bm, p) : on_bestmove(bm, p);
+    });
     engine.set_on_verify_networks([](const auto& s) { print_info_string(s); });
 }
 
@@ -126,6 +215,16 @@ void UCIEngine::loop() {
             print_info_string(engine.thread_allocation_information_as_string());
             go(is);  // 调用搜索处理函数
         }
+        // 挂起当前搜索并保留其状态，稍后用"resume"继续（非标准UCI扩展）
+        else if (token == "suspend")
+            print_info_string(engine.suspend()       ? "search suspended"
+                              : engine.can_suspend() ? "no search to suspend"
+                                                     : "a search is already suspended");
+        else if (token == "resume")
+        {
+            if (!engine.resume())
+                print_info_string("no suspended search");
+        }
         // 设置棋盘位置命令
         else if (token == "position")
             position(is);
@@ -146,12 +245,32 @@ void UCIEngine::loop() {
             bench(is);
         else if (token == BenchmarkCommand)  // 运行speedtest
             benchmark(is);
+        else if (token == "perftsuite")  // 并行验证EPD文件中的perft结果
+            perftsuite(is);
+        else if (token == "annotate")  // 从终局向开局倒序分析整盘棋，输出JSON行
+            annotate(is);
+        else if (token == "gobatch")  // 在所有线程上并行搜索大量互不相关的局面
+            gobatch(is);
+        else if (token == "import")  // 并行解析ICCS/WXF棋谱文件并转换为着法流
+            import(is);
+        else if (token == "solve")  // 运行带bm/am标注的战术测试集，统计解题时间
+            solve(is);
         else if (token == "d")  // 可视化当前棋盘状态
             sync_cout << engine.visualize() << sync_endl;
-        else if (token == "eval")  // 输出当前局面评估细节
-            engine.trace_eval();
+        else if (token == "eval")  // 输出当前局面评估细节，"eval json" 输出各棋子价值
+            eval(is);
+        else if (token == "hashstats")  // 扫描整个置换表并输出占用统计
+            sync_cout << engine.hash_stats() << sync_endl;
         else if (token == "compiler")  // 显示编译器信息
             sync_cout << compiler_info() << sync_endl;
+        else if (token == "savehistory" || token == "loadhistory") {  // 保存/载入历史表，用于新进程热启动
+            std::string file;
+            if (!(is >> std::skipws >> file))
+                sync_cout << "Usage: " << token << " <file>" << sync_endl;
+            else
+                print_info_string(token == "savehistory" ? engine.save_history(file)
+                                                         : engine.load_history(file));
+        }
         else if (token == "export_net") {  // 导出神经网络权重
             std::optional<std::string> file;
             std::string                f;
@@ -217,12 +336,24 @@ Search::LimitsType UCIEngine::parse_limits(std::istream& is) {
 
 void UCIEngine::go(std::istringstream& is) {
 
+    // "go priority ..." preempts the running search until this one is done
+    std::string token;
+    const auto  start    = is.tellg();
+    const bool  priority = (is >> token) && token == "priority";
+
+    if (!priority)
+        is.clear(), is.seekg(start);
+
     Search::LimitsType limits = parse_limits(is);
 
     if (limits.perft)
         perft(limits);
-    else
+    else if (!priority)
         engine.go(limits);
+    else if (limits.infinite || limits.ponderMode)
+        print_info_string("priority searches must have a limit");
+    else if (!engine.go_priority(limits))
+        print_info_string("priority search refused, a search is already suspended");
 }
 
 void UCIEngine::bench(std::istream& args) {
@@ -231,6 +362,8 @@ void UCIEngine::bench(std::istream& args) {
     uint64_t    nodesSearched = 0;
     const auto& options       = engine.get_options();
 
+    PerfCounters::Sample perfSample;
+
     engine.set_on_update_full([&](const auto& i) {
         nodesSearched = i.nodes;
         on_update_full(i, options["UCI_ShowWDL"]);
@@ -260,8 +393,10 @@ void UCIEngine::bench(std::istream& args) {
                     nodesSearched = perft(limits);
                 else
                 {
+                    engine.start_perf_counters();
                     engine.go(limits);
                     engine.wait_for_search_finished();
+                    perfSample += engine.stop_perf_counters();
                 }
 
                 nodes += nodesSearched;
@@ -288,7 +423,12 @@ void UCIEngine::bench(std::istream& args) {
     std::cerr << "\n==========================="    //
               << "\nTotal time (ms) : " << elapsed  //
               << "\nNodes searched  : " << nodes    //
-              << "\nNodes/second    : " << 1000 * nodes / elapsed << std::endl;
+              << "\nNodes/second    : " << 1000 * nodes / elapsed;
+
+    if (!perfSample.empty)
+        std::cerr << PerfCounters::report(perfSample, nodes, 16);
+
+    std::cerr << std::endl;
 
     // reset callback, to not capture a dangling reference to nodesSearched
     engine.set_on_update_full([&](const auto& i) { on_update_full(i, options["UCI_ShowWDL"]); });
@@ -302,6 +442,8 @@ void UCIEngine::benchmark(std::istream& args) {
     uint64_t    nodes = 0, cnt = 1;
     uint64_t    nodesSearched = 0;
 
+    PerfCounters::Sample perfSample;
+
     engine.set_on_update_full([&](const Engine::InfoFull& i) { nodesSearched = i.nodes; });
 
     engine.set_on_iter([](const auto&) {});
@@ -392,6 +534,8 @@ void UCIEngine::benchmark(std::istream& args) {
 
             Search::LimitsType limits = parse_limits(is);
 
+            engine.start_perf_counters();
+
             TimePoint elapsed = now();
 
             // Run with silenced network verification
@@ -400,6 +544,8 @@ void UCIEngine::benchmark(std::istream& args) {
 
             totalTime += now() - elapsed;
 
+            perfSample += engine.stop_perf_counters();
+
             updateHashfullReadings();
 
             nodes += nodesSearched;
@@ -449,7 +595,8 @@ void UCIEngine::benchmark(std::istream& args) {
               << totalHashfull[1] / numHashfullReadings
               << "\nTotal nodes searched       : " << nodes
               << "\nTotal search time [s]      : " << totalTime / 1000.0
-              << "\nNodes/second               : " << 1000 * nodes / totalTime << std::endl;
+              << "\nNodes/second               : " << 1000 * nodes / totalTime
+              << PerfCounters::report(perfSample, nodes, 27) << std::endl;
 
     // clang-format on
 
@@ -457,7 +604,18 @@ void UCIEngine::benchmark(std::istream& args) {
 }
 
 void UCIEngine::setoption(std::istringstream& is) {
-    engine.wait_for_search_finished();
+
+    // A new network is swapped in during the search, any other option waits
+    // for the search to finish.
+    std::string token, name;
+    const auto  start = is.tellg();
+
+    is >> token >> name;
+    is.clear(), is.seekg(start);
+
+    if (name != "EvalFile")
+        engine.wait_for_search_finished();
+
     engine.get_options().setoption(is);
 }
 
@@ -467,6 +625,785 @@ std::uint64_t UCIEngine::perft(const Search::LimitsType& limits) {
     return nodes;
 }
 
+// Verifies the perft results of an EPD file, where each line holds a position
+// followed by the expected node counts, e.g. "<fen> ;D1 44 ;D2 1920". All the
+// checks run in parallel on the search threads, the divide output of every
+// mismatch is printed afterwards.
+void UCIEngine::perftsuite(std::istream& args) {
+    std::string fileName, line;
+    args >> fileName;
+
+    std::ifstream file(fileName);
+
+    if (!file.is_open())
+    {
+        sync_cout << "Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    std::vector<std::pair<std::string, Depth>> jobs;
+    std::vector<std::uint64_t>                 expected;
+    size_t                                     positions = 0, lineNumber = 0;
+
+    while (getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string        fen, field;
+
+        ++lineNumber;
+
+        getline(ss, fen, ';');
+        fen.erase(fen.find_last_not_of(" \t\r") + 1);
+
+        if (fen.empty() || fen[0] == '#')
+            continue;
+
+        ++positions;
+
+        while (getline(ss, field, ';'))
+        {
+            std::istringstream fs(field);
+            std::string        depth;
+            std::uint64_t      nodes;
+
+            if (!(fs >> depth) || depth[0] != 'D')
+                continue;
+
+            // Exceptions are disabled, so the depth is parsed without std::stoi()
+            int d          = 0;
+            auto [ptr, ec] = std::from_chars(depth.data() + 1, depth.data() + depth.size(), d);
+
+            if (ec != std::errc() || ptr != depth.data() + depth.size() || d <= 0 || d >= MAX_PLY
+                || !(fs >> nodes))
+            {
+                sync_cout << "Skipping line " << lineNumber << " field '" << depth
+                          << "': expected a depth and a node count" << sync_endl;
+                continue;
+            }
+
+            jobs.emplace_back(fen, d);
+            expected.push_back(nodes);
+        }
+    }
+
+    TimePoint elapsed = now();
+
+    std::vector<std::uint64_t> results = engine.perft_batch(jobs);
+
+    elapsed = std::max<TimePoint>(now() - elapsed, 1);
+
+    std::uint64_t       totalNodes = 0;
+    std::vector<size_t> failed;
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        totalNodes += results[i];
+
+        if (results[i] != expected[i])
+            failed.push_back(i);
+    }
+
+    for (size_t i : failed)
+    {
+        sync_cout << "\nMismatch: " << jobs[i].first << " depth " << jobs[i].second
+                  << " expected " << expected[i] << " got " << results[i] << "\n"
+                  << sync_endl;
+        engine.perft(jobs[i].first, jobs[i].second);
+    }
+
+    sync_cout << "\n==========================="
+              << "\nPositions       : " << positions  //
+              << "\nChecks          : " << jobs.size()
+              << "\nFailed          : " << failed.size()
+              << "\nTotal time (ms) : " << elapsed  //
+              << "\nNodes searched  : " << totalNodes
+              << "\nNodes/second    : " << 1000 * totalNodes / elapsed << sync_endl;
+}
+
+namespace {
+
+// Reads a game given as in the "position" command, a bare move list meaning
+// the game starts from the initial position.
+bool parse_game(std::istream& is, std::string& fen, std::vector<std::string>& moves) {
+    std::string token;
+
+    fen.clear();
+    moves.clear();
+
+    if (!(is >> token))
+        return false;
+
+    if (token == "startpos")
+        fen = StartFEN;
+    else if (token == "fen")
+        while (is >> token && token != "moves")
+            fen += token + " ";
+    else
+    {
+        fen = StartFEN;
+        if (token != "moves")
+            moves.push_back(token);
+    }
+
+    while (is >> token)
+        if (token != "moves")
+            moves.push_back(token);
+
+    return true;
+}
+
+// A position of a test suite, its best and avoided moves in UCI notation
+struct SuitePosition {
+    std::string              id, fen;
+    std::vector<std::string> bestMoves, avoidMoves;
+};
+
+// Reads an EPD line as "<fen> bm C2.5 h2e6; am h0g2; id "name";". The fen ends
+// before the first operation, whose code is a word of two letters or more.
+std::optional<SuitePosition> parse_epd(const std::string& line) {
+    std::istringstream ss(line);
+    std::string        token;
+    SuitePosition      sp;
+    std::streamoff     opStart = -1;
+
+    ss >> sp.fen;
+
+    for (std::streamoff p = ss.tellg(); ss >> token; p = ss.tellg())
+    {
+        if (token.size() > 1 && std::isalpha(token[0]))
+        {
+            opStart = p;
+            break;
+        }
+
+        sp.fen += " " + token;
+    }
+
+    if (opStart < 0)
+        return std::nullopt;
+
+    StateInfo st;
+    Position  pos;
+    pos.set(sp.fen, &st);
+
+    std::istringstream ops(line.substr(size_t(opStart)));
+
+    for (std::string op; getline(ops, op, ';');)
+    {
+        std::istringstream os(op);
+        std::string        code;
+        os >> code;
+
+        if (code == "id")
+        {
+            getline(os >> std::ws, sp.id);
+            sp.id.erase(std::remove(sp.id.begin(), sp.id.end(), '"'), sp.id.end());
+        }
+        else if (code == "bm" || code == "am")
+            while (os >> token)
+            {
+                Move m = GameRecord::from_notation(pos, token);
+
+                if (m == Move::none())
+                    return std::nullopt;
+
+                (code == "bm" ? sp.bestMoves : sp.avoidMoves).push_back(UCIEngine::move(m));
+            }
+    }
+
+    if (sp.bestMoves.empty() && sp.avoidMoves.empty())
+        return std::nullopt;
+
+    return sp;
+}
+
+// Follows the move heading the PV of a suite position. The position counts as
+// solved from the moment the head becomes a right move, as long as it stays one.
+struct SolveProgress {
+    void update(const SuitePosition& sp, std::string_view head, TimePoint time, uint64_t n) {
+        bool right = sp.bestMoves.empty()
+                     ? std::find(sp.avoidMoves.begin(), sp.avoidMoves.end(), head)
+                         == sp.avoidMoves.end()
+                     : std::find(sp.bestMoves.begin(), sp.bestMoves.end(), head)
+                         != sp.bestMoves.end();
+
+        if (right && !solved)
+        {
+            timeMs = time;
+            nodes  = n;
+        }
+
+        solved = right;
+        best   = head;
+    }
+
+    bool        solved = false;
+    TimePoint   timeMs = 0;
+    uint64_t    nodes  = 0;
+    std::string best;
+};
+
+}  // namespace
+
+// Analyses whole games from the last position back to the first one, e.g.
+// "annotate depth 12 startpos moves h2e2 h9g7" or "annotate movetime 100 file
+// games.txt", the file holding one game per line. Only "depth", "nodes" and
+// "movetime" limits are supported. The hash table and the histories are cleared
+// first, then kept between the positions, so each search finds the subtrees of
+// the position after it already explored. One JSON object is printed per
+// position as soon as it is analysed, the score of the move played being the
+// negated score of the next position, followed by a summary. The position set
+// before is restored at the end.
+void UCIEngine::annotate(std::istream& args) {
+    std::string              token, limitsStr, fileName;
+    std::vector<std::string> games;
+
+    while (args >> token && token != "file" && token != "startpos" && token != "fen"
+           && token != "moves")
+        limitsStr += token + " ";
+
+    if (token == "file")
+    {
+        args >> fileName;
+
+        std::ifstream file(fileName);
+
+        if (!file.is_open())
+        {
+            sync_cout << "Unable to open file " << fileName << sync_endl;
+            return;
+        }
+
+        for (std::string line; getline(file, line);)
+            if (!is_whitespace(line) && line[0] != '#')
+                games.push_back(line);
+    }
+    else if (!args.fail())
+    {
+        std::string rest;
+        getline(args, rest);
+        games.push_back(token + rest);
+    }
+
+    if (games.empty())
+    {
+        sync_cout << "No game to annotate" << sync_endl;
+        return;
+    }
+
+    if (limitsStr.empty())
+        limitsStr = "depth 10";
+
+    std::istringstream       ls(limitsStr);
+    Search::LimitsType       limits = parse_limits(ls);
+
+    // No stop can be read while annotating, so every search must end by itself
+    if (limits.infinite || limits.ponderMode
+        || (!limits.depth && !limits.nodes && !limits.movetime))
+    {
+        sync_cout << "annotate needs a depth, nodes or movetime limit" << sync_endl;
+        return;
+    }
+
+    const auto [setupFen, setupMoves] = engine.position_setup();
+    std::string              bestMove;
+    std::string              pv;
+    std::optional<Score>     score;
+    size_t                   nodes = 0, positions = 0, totalNodes = 0;
+    int                      depth = 0;
+
+    // The network is verified before every search, report it only once
+    engine.set_on_verify_networks([&](const auto& s) {
+        if (!positions)
+            print_info_string(s);
+    });
+    engine.set_on_iter([](const auto&) {});
+    engine.set_on_update_no_moves([&](const auto& i) {
+        score = i.score;
+        depth = i.depth;
+    });
+    engine.set_on_update_full([&](const auto& i) {
+        if (i.multiPV != 1)
+            return;
+
+        score = i.score;
+        depth = i.depth;
+        nodes = i.nodes;
+        pv    = i.pv;
+    });
+    engine.set_on_bestmove([&](std::string_view bm, std::string_view) { bestMove = bm; });
+
+    engine.search_clear();
+
+    TimePoint elapsed = now();
+
+    for (size_t g = 0; g < games.size(); ++g)
+    {
+        std::istringstream       gs(games[g]);
+        std::string              fen;
+        std::vector<std::string> moves;
+
+        if (!parse_game(gs, fen, moves))
+            continue;
+
+        // Drop everything from the first illegal move on
+        Position     pos;
+        StateListPtr states(new std::deque<StateInfo>(1));
+        pos.set(fen, &states->back());
+
+        size_t legal = 0;
+        for (; legal < moves.size(); ++legal)
+        {
+            Move m = to_move(pos, moves[legal]);
+            if (m == Move::none())
+                break;
+
+            states->emplace_back();
+            pos.do_move(m, states->back());
+        }
+
+        if (legal < moves.size())
+        {
+            std::string out;
+
+            out += "{\"game\":";
+            append_number(out, g + 1);
+            out += ",\"error\":";
+            append_string(out, "illegal move " + moves[legal] + " at ply "
+                                 + std::to_string(legal + 1));
+            out += '}';
+
+            sync_cout << out << sync_endl;
+        }
+
+        moves.resize(legal);
+
+        std::optional<Score> nextScore;
+
+        for (size_t ply = moves.size() + 1; ply-- > 0;)
+        {
+            engine.set_position(fen, std::vector<std::string>(moves.begin(), moves.begin() + ply));
+
+            score.reset();
+            bestMove.clear();
+            pv.clear();
+            nodes = 0;
+
+            limits.startTime = now();
+            engine.go(limits);
+            engine.wait_for_search_finished();
+
+            totalNodes += nodes;
+            ++positions;
+
+            std::string out;
+
+            out += "{\"game\":";
+            append_number(out, g + 1);
+            out += ",\"ply\":";
+            append_number(out, ply);
+            out += ",\"fen\":";
+            append_string(out, engine.fen());
+            out += ",\"move\":";
+
+            if (ply < moves.size())
+                append_string(out, moves[ply]);
+            else
+                out += "null";
+
+            out += ",\"best\":";
+
+            if (!bestMove.empty() && bestMove != "(none)")
+                append_string(out, bestMove);
+            else
+                out += "null";
+
+            if (score)
+            {
+                out += ",\"score\":";
+                append_score(out, *score);
+            }
+
+            if (ply < moves.size() && nextScore)
+            {
+                out += ",\"moveScore\":";
+                append_score(out, *nextScore, true);
+            }
+
+            out += ",\"depth\":";
+            append_number(out, depth);
+            out += ",\"nodes\":";
+            append_number(out, nodes);
+            out += ",\"pv\":";
+            append_list(out, pv, true);
+            out += '}';
+
+            sync_cout << out << sync_endl;
+
+            nextScore = score;
+        }
+    }
+
+    elapsed = std::max<TimePoint>(now() - elapsed, 1);
+
+    sync_cout << "{\"games\":" << games.size() << ",\"positions\":" << positions
+              << ",\"timeMs\":" << elapsed << ",\"nodes\":" << totalNodes
+              << ",\"positionsPerSecond\":" << 1000.0 * positions / elapsed
+              << ",\"nps\":" << 1000 * totalNodes / elapsed << "}" << sync_endl;
+
+    engine.set_position(setupFen, setupMoves);
+    init_search_update_listeners();
+}
+
+// Searches many unrelated positions, e.g. "gobatch nodes 3000 file positions.txt",
+// the file holding one position per line as in the "position" command. Each
+// search runs on a single thread and the threads take the positions one after
+// the other, which keeps every core busy with low node searches that would not
+// scale over several threads. Only "depth", "nodes" and "movetime" limits are
+// supported. A position with an illegal move is reported with its line number
+// instead of being searched.
+void UCIEngine::gobatch(std::istream& args) {
+    std::string token, limitsStr, fileName;
+
+    while (args >> token && token != "file")
+        limitsStr += token + " ";
+
+    args >> fileName;
+
+    std::ifstream file(fileName);
+
+    if (!file.is_open())
+    {
+        sync_cout << "Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    std::vector<ThreadPool::BatchJob> jobs;
+    std::vector<size_t>               lineNumbers;
+    size_t                            lineNumber = 0;
+
+    for (std::string line; getline(file, line);)
+    {
+        std::istringstream       ls(line);
+        std::string              fen;
+        std::vector<std::string> moves;
+
+        ++lineNumber;
+
+        if (!is_whitespace(line) && line[0] != '#' && parse_game(ls, fen, moves))
+        {
+            jobs.emplace_back(fen, moves);
+            lineNumbers.push_back(lineNumber);
+        }
+    }
+
+    if (limitsStr.empty())
+        limitsStr = "nodes 5000";
+
+    std::istringstream ls(limitsStr);
+    Search::LimitsType limits = parse_limits(ls);
+
+    if (!limits.depth && !limits.nodes && !limits.movetime)
+    {
+        sync_cout << "gobatch needs a depth, nodes or movetime limit" << sync_endl;
+        return;
+    }
+
+    TimePoint elapsed = now();
+
+    std::vector<Search::BatchResult> results = engine.search_batch(jobs, limits);
+
+    elapsed = std::max<TimePoint>(now() - elapsed, 1);
+
+    std::uint64_t totalNodes = 0;
+    size_t        searched   = 0;
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& r = results[i];
+
+        if (!r.error.empty())
+        {
+            sync_cout << i + 1 << " invalid line " << lineNumbers[i] << ": " << r.error
+                      << sync_endl;
+            continue;
+        }
+
+        totalNodes += r.nodes;
+        ++searched;
+
+        sync_cout << i + 1 << " bestmove " << move(r.bestMove) << " score "
+                  << format_score(r.score) << " depth " << r.depth << " nodes " << r.nodes
+                  << sync_endl;
+    }
+
+    size_t threads = engine.get_options()["Threads"];
+
+    sync_cout << "\n==========================="
+              << "\nPositions       : " << searched                   //
+              << "\nInvalid         : " << results.size() - searched  //
+              << "\nThreads         : " << threads                    //
+              << "\nTotal time (ms) : " << elapsed                    //
+              << "\nNodes searched  : " << totalNodes
+              << "\nNodes/second    : " << 1000 * totalNodes / elapsed
+              << "\nMoves/second    : " << 1000 * searched / elapsed
+              << "\nMoves/s/thread  : " << 1000.0 * searched / elapsed / threads << sync_endl;
+}
+
+// Converts a file of games in ICCS or WXF notation, e.g. "import games.pgn
+// games.txt" or "import games.pgn games.bin binary", see GameRecord::Format.
+// Every game is validated move by move, an illegal move dropping the rest of
+// the game.
+void UCIEngine::import(std::istream& args) {
+    std::string input, output, format;
+    args >> input >> output >> format;
+
+    if (output.empty())
+    {
+        sync_cout << "Usage: import <input> <output> [text|binary]" << sync_endl;
+        return;
+    }
+
+    TimePoint elapsed = now();
+
+    GameRecord::ImportStats stats = engine.import_games(
+      input, output, format == "binary" ? GameRecord::Format::Binary : GameRecord::Format::Text);
+
+    elapsed = std::max<TimePoint>(now() - elapsed, 1);
+
+    if (!stats.failure.empty())
+    {
+        sync_cout << stats.failure << sync_endl;
+        return;
+    }
+
+    for (const auto& e : stats.errors)
+        sync_cout << "Invalid " << e << sync_endl;
+
+    sync_cout << "\n==========================="
+              << "\nGames           : " << stats.games  //
+              << "\nInvalid games   : " << stats.invalid
+              << "\nMoves           : " << stats.moves  //
+              << "\nTotal time (ms) : " << elapsed       //
+              << "\nGames/second    : " << 1000 * stats.games / elapsed
+              << "\nMoves/second    : " << 1000 * stats.moves / elapsed << sync_endl;
+}
+
+// Runs a tactical test suite and measures the time to solution, e.g. "solve
+// suite.epd 1000" to search each position for 1000 ms with all the threads, or
+// "solve suite.epd 1000 4" to search four positions at a time, with a thread
+// each. The positions come as EPD lines with "bm" and "am" operations, in ICCS
+// or WXF notation. A position is solved at the time and nodes of the last
+// change of the PV head to a best move, or to a move other than the avoided
+// ones, if it is still heading the PV at the end of the search.
+void UCIEngine::solve(std::istream& args) {
+    std::string fileName;
+    TimePoint   movetime    = 0;
+    size_t      concurrency = 1;
+
+    args >> fileName >> movetime >> concurrency;
+
+    std::ifstream file(fileName);
+
+    if (!file.is_open())
+    {
+        sync_cout << "Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    if (movetime <= 0)
+    {
+        sync_cout << "Usage: solve <epd> <movetime> [concurrency]" << sync_endl;
+        return;
+    }
+
+    std::vector<SuitePosition> suite;
+    size_t                     lineNumber = 0;
+
+    for (std::string line; getline(file, line);)
+    {
+        ++lineNumber;
+
+        if (is_whitespace(line) || line[0] == '#')
+            continue;
+
+        if (auto sp = parse_epd(line))
+        {
+            if (sp->id.empty())
+                sp->id = "line " + std::to_string(lineNumber);
+
+            suite.push_back(std::move(*sp));
+        }
+        else
+            sync_cout << "Skipping line " << lineNumber << ": no valid bm or am operation"
+                      << sync_endl;
+    }
+
+    Search::LimitsType limits;
+    limits.movetime = movetime;
+
+    std::vector<SolveProgress> progress(suite.size());
+    TimePoint                  elapsed = now();
+
+    if (concurrency > 1)
+    {
+        std::vector<ThreadPool::BatchJob> jobs;
+        for (const auto& sp : suite)
+            jobs.emplace_back(sp.fen, std::vector<std::string>());
+
+        engine.search_clear();
+
+        auto results = engine.search_batch(jobs, limits, concurrency, [&](size_t i, const auto& r) {
+            progress[i].update(suite[i], move(r.bestMove), r.timeMs, r.nodes);
+        });
+
+        for (size_t i = 0; i < suite.size(); ++i)
+            progress[i].update(suite[i], move(results[i].bestMove), results[i].timeMs,
+                               results[i].nodes);
+    }
+    else
+    {
+        SolveProgress* current = nullptr;
+        size_t         index   = 0;
+        uint64_t       nodes   = 0;
+
+        // The network is verified before every search, report it only once
+        engine.set_on_verify_networks([&](const auto& str) {
+            if (!index)
+                print_info_string(str);
+        });
+        engine.set_on_iter([](const auto&) {});
+        engine.set_on_update_no_moves([](const auto&) {});
+        engine.set_on_update_full([&](const auto& i) {
+            if (i.multiPV != 1)
+                return;
+
+            nodes = i.nodes;
+            current->update(suite[index], i.pv.substr(0, i.pv.find(' ')), TimePoint(i.timeMs),
+                            i.nodes);
+        });
+        engine.set_on_bestmove([&](std::string_view bestmove, std::string_view) {
+            if (bestmove != current->best)
+                current->update(suite[index], bestmove, now() - limits.startTime, nodes);
+        });
+
+        for (; index < suite.size(); ++index)
+        {
+            current = &progress[index];
+            nodes   = 0;
+
+            engine.search_clear();
+            engine.set_position(suite[index].fen, {});
+
+            limits.startTime = now();
+            engine.go(limits);
+            engine.wait_for_search_finished();
+        }
+
+        init_search_update_listeners();
+    }
+
+    elapsed = std::max<TimePoint>(now() - elapsed, 1);
+
+    std::vector<TimePoint> times;
+
+    for (size_t i = 0; i < suite.size(); ++i)
+    {
+        const auto& p = progress[i];
+
+        if (p.solved)
+        {
+            times.push_back(p.timeMs);
+            sync_cout << i + 1 << " " << suite[i].id << ": solved in " << p.timeMs << " ms, "
+                      << p.nodes << " nodes" << sync_endl;
+        }
+        else
+            sync_cout << i + 1 << " " << suite[i].id << ": not solved, played "
+                      << (p.best.empty() ? "(none)" : p.best) << sync_endl;
+    }
+
+    std::sort(times.begin(), times.end());
+
+    sync_cout << "\n==========================="
+              << "\nPositions       : " << suite.size()  //
+              << "\nSolved          : " << times.size()
+              << "\nTotal time (ms) : " << elapsed << sync_endl;
+
+    if (times.empty())
+        return;
+
+    // Number of positions solved within each time, up to the movetime
+    std::stringstream ss;
+
+    auto solved_within = [&](TimePoint limit) {
+        ss << "\nSolved <= " << std::left << std::setw(6) << std::to_string(limit) + "ms" << ": "
+           << std::upper_bound(times.begin(), times.end(), limit) - times.begin();
+    };
+
+    for (TimePoint t = 10; t < movetime; t *= 10)
+        for (TimePoint limit : {t, 2 * t, 5 * t})
+            if (limit < movetime)
+                solved_within(limit);
+
+    solved_within(movetime);
+
+    TimePoint total = 0;
+    for (TimePoint t : times)
+        total += t;
+
+    sync_cout << ss.str().substr(1)  //
+              << "\nMedian (ms)     : " << times[times.size() / 2]
+              << "\nMean (ms)       : " << total / TimePoint(times.size()) << sync_endl;
+}
+
+// Prints the evaluation of the current position. With "eval json", only the
+// NNUE evaluation and the value of each piece are printed, as one JSON object,
+// e.g. {"fen":"...","eval":25,"pieces":[{"square":"a0","piece":"R","cp":530},
+// ...]}, in centipawns from White's point of view. In check, where there is
+// no static evaluation, the eval is null and the list of pieces empty.
+void UCIEngine::eval(std::istream& args) {
+    std::string token;
+
+    if (!(args >> token) || token != "json")
+    {
+        engine.trace_eval();
+        return;
+    }
+
+    const auto  pv = engine.piece_values();
+    std::string out;
+
+    out += "{\"fen\":";
+    append_string(out, engine.fen());
+    out += ",\"eval\":";
+
+    if (pv)
+        append_number(out, pv->eval);
+    else
+        out += "null";
+
+    out += ",\"pieces\":[";
+
+    if (pv)
+        for (const auto& piece : pv->pieces)
+        {
+            if (out.back() != '[')
+                out += ',';
+
+            out += "{\"square\":";
+            append_string(out, square(piece.sq));
+            out += ",\"piece\":";
+            append_string(out, PieceToChar.substr(piece.pc, 1));
+            out += ",\"cp\":";
+            append_number(out, piece.cp);
+            out += '}';
+        }
+
+    out += "]}";
+
+    sync_cout << out << sync_endl;
+}
+
 void UCIEngine::position(std::istringstream& is) {
     std::string token, fen;
 
@@ -641,4 +1578,91 @@ void UCIEngine::on_bestmove(std::string_view bestmove, std::string_view ponder)
     std::cout << sync_endl;
 }
 
+// The same updates as single line JSON objects, selected by the "JSON Output"
+// option, for consumers that would rather not tokenise the UCI text.
+void UCIEngine::on_update_no_moves_json(const Engine::InfoShort& info) {
+    std::string out;
+
+    out += "{\"type\":\"info\",\"depth\":";
+    append_number(out, info.depth);
+    out += ",\"score\":";
+    append_score(out, info.score);
+    out += '}';
+
+    sync_cout << out << sync_endl;
+}
+
+void UCIEngine::on_update_full_json(const Engine::InfoFull& info, bool showWDL) {
+    std::string out;
+    out.reserve(256 + info.pv.size() * 2);
+
+    out += "{\"type\":\"info\",\"depth\":";
+    append_number(out, info.depth);
+    out += ",\"seldepth\":";
+    append_number(out, info.selDepth);
+    out += ",\"multipv\":";
+    append_number(out, info.multiPV);
+    out += ",\"score\":";
+    append_score(out, info.score);
+
+    if (showWDL)
+    {
+        out += ",\"wdl\":";
+        append_list(out, info.wdl, false);
+    }
+
+    if (!info.bound.empty())
+    {
+        out += ",\"bound\":";
+        append_string(out, info.bound);
+    }
+
+    out += ",\"nodes\":";
+    append_number(out, info.nodes);
+    out += ",\"nps\":";
+    append_number(out, info.nps);
+    out += ",\"hashfull\":";
+    append_number(out, info.hashfull);
+    out += ",\"tbhits\":";
+    append_number(out, info.tbHits);
+    out += ",\"time\":";
+    append_number(out, info.timeMs);
+    out += ",\"pv\":";
+    append_list(out, info.pv, true);
+    out += '}';
+
+    sync_cout << out << sync_endl;
+}
+
+void UCIEngine::on_iter_json(const Engine::InfoIter& info) {
+    std::string out;
+
+    out += "{\"type\":\"currmove\",\"depth\":";
+    append_number(out, info.depth);
+    out += ",\"currmove\":";
+    append_string(out, info.currmove);
+    out += ",\"currmovenumber\":";
+    append_number(out, info.currmovenumber);
+    out += '}';
+
+    sync_cout << out << sync_endl;
+}
+
+void UCIEngine::on_bestmove_json(std::string_view bestmove, std::string_view ponder) {
+    std::string out;
+
+    out += "{\"type\":\"bestmove\",\"bestmove\":";
+    append_string(out, bestmove);
+
+    if (!ponder.empty())
+    {
+        out += ",\"ponder\":";
+        append_string(out, ponder);
+    }
+
+    out += '}';
+
+    sync_cout << out << sync_endl;
+}
+
 }  // namespace Stockfish
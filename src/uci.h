@@ -65,12 +65,23 @@ class UCIEngine {
     void          position(std::istringstream& is);
     void          setoption(std::istringstream& is);
     std::uint64_t perft(const Search::LimitsType&);
+    void          perftsuite(std::istream& args);
+    void          annotate(std::istream& args);
+    void          gobatch(std::istream& args);
+    void          import(std::istream& args);
+    void          solve(std::istream& args);
+    void          eval(std::istream& args);
 
     static void on_update_no_moves(const Engine::InfoShort& info);
     static void on_update_full(const Engine::InfoFull& info, bool showWDL);
     static void on_iter(const Engine::InfoIter& info);
     static void on_bestmove(std::string_view bestmove, std::string_view ponder);
 
+    static void on_update_no_moves_json(const Engine::InfoShort& info);
+    static void on_update_full_json(const Engine::InfoFull& info, bool showWDL);
+    static void on_iter_json(const Engine::InfoIter& info);
+    static void on_bestmove_json(std::string_view bestmove, std::string_view ponder);
+
     void init_search_update_listeners();
 };
 